@@ -9,24 +9,161 @@
  *
  * The program loads boat data from a CSV file, allows the user to manage the inventory,
  * and saves the data back to the file when exiting.
+ *
+ * Entering "I <prefix>" at the menu lists only the boats whose names start with <prefix>.
+ * Large inventories can be paged through with "V" (see below), or written to a file in the
+ * background with "W <filename>" while the menu stays available. "F slip" finds a free slip
+ * (see below for the other location queries).
+ *
+ * Running "BoatManagement <filename.csv> --batch <commands.txt>" (or "-" for stdin) executes
+ * commands without prompts, one per line, loading and saving the file once:
+ *   I [prefix]          print the inventory
+ *   A <csv line>        add a boat
+ *   R <name>            remove a boat
+ *   P <name>,<amount>   accept a payment
+ *   M                   charge a new month
+ *   S <filename>        save a copy (snapshot for ".bms", otherwise CSV)
+ *   F slip|storage [n]  show whether place n is free, or find the first free one
+ *   F slip|storage =<n> search places 1 to n for free ones from now on (85 slips and 50
+ *                       storage spaces until then)
+ *   F land <bay>        count the boats in a bay
+ *   F trailor <tag>     show whether a trailor tag is in use
+ *   V [+|-|<name>]      show the next page of the inventory, the previous one, or the page
+ *                       starting at the first boat not before <name>
+ *   V =<n>              show n boats per page from now on
+ *   W <filename>        write the whole inventory to a file in a background process
+ *   X                   stop reading commands
+ * The argument starts after the single space following the command letter; any further
+ * spaces belong to it. Blank lines and lines starting with '#' are ignored.
+ *
+ * Every change is also appended to <filename.csv>.journal in the same command format and
+ * flushed to disk, and the journal is replayed on the next start. A name shared by several
+ * boats always means the first of them in name order (boats with equal names keep the order
+ * they were loaded or added in), so a replayed record changes the same boat as the original.
+ * The CSV file itself is only rewritten (and the journal emptied) once the journal outgrows
+ * half the size of the CSV file, or on exit when the CSV file is small enough that rewriting
+ * it is cheap.
+ *
+ * A file whose name ends in ".bms" is kept as a binary snapshot instead of CSV, which loads
+ * and saves without any text conversion. Files are recognised by content when loading, so
+ * giving a CSV file a ".bms" name imports it, and the batch command "S <filename>" saves a
+ * copy in the format given by that file's extension (CSV export). When only balances have
+ * changed since a snapshot was saved, saving it rewrites just the changed records in place,
+ * through a small redo log (<filename>.patch) that is finished on the next start after a crash.
+ *
+ * Slips or storage spaces assigned to more than one boat, and trailor tags used twice, are
+ * reported after loading.
+ *
+ * Large CSV files are parsed and sorted on one thread per core, so build with -pthread.
+ *
+ * Running "BoatManagement --bench [boats ...]" times the hot paths on generated data (the same
+ * data every run) once for each boat count given, 1000, 100000 and 1000000 by default, next to
+ * the code they replaced; run it with 10000000 to see how the store scales.
  */
 
  #include <stdio.h>
+ #include <errno.h>
  #include <stdlib.h>
  #include <string.h>
  #include <ctype.h>
+ #include <stdarg.h>
+ #include <stdint.h>
+ #include <limits.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <sys/wait.h>
+ 
+ /* x86 builds carry SSE2/AVX2/AVX-512 billing kernels, chosen at run time */
+ #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #include <immintrin.h>
+ #define HAVE_X86_KERNELS 1
+ #endif
  
- #define MAX_BOATS 120
  #define MAX_NAME_LENGTH 128
  #define MAX_BOAT_LENGTH 100
  #define MAX_SLIP_NUM 85
  #define MAX_STORAGE_SPACE 50
  
- /* Rates per foot per month */
- #define SLIP_RATE 12.50
- #define LAND_RATE 14.00
- #define TRAILOR_RATE 25.00
- #define STORAGE_RATE 11.20
+ /* Rates in cents per foot per month */
+ #define SLIP_RATE 1250
+ #define LAND_RATE 1400
+ #define TRAILOR_RATE 2500
+ #define STORAGE_RATE 1120
+ 
+ /* Largest balance or payment either way, in cents; charging it for ages cannot overflow */
+ #define MAX_CENTS (INT64_MAX / 100)
+ 
+ /* Binary snapshot files: extension, magic bytes and format version */
+ #define SNAPSHOT_EXTENSION ".bms"
+ #define SNAPSHOT_MAGIC "BMS1"
+ #define SNAPSHOT_VERSION 1
+ #define SNAPSHOT_PATCH_MAGIC "BMP1"
+ 
+ /* Output buffer size for saving files */
+ #define SAVE_BUFFER_SIZE (1 << 20)
+ 
+ /* Batch commands run between two flushes of the journal to disk */
+ #define JOURNAL_BATCH_COMMANDS 256
+ 
+ /* Data files up to this size are always saved on exit instead of leaving a journal behind */
+ #define JOURNAL_EXIT_SAVE_BYTES (1 << 20)
+ 
+ /* CSV text given to each loader thread, at least; smaller files are parsed on one thread */
+ #define LOAD_CHUNK_BYTES (1 << 20)
+ #define MAX_LOAD_THREADS 64
+ 
+ /* Boats given to each sorting thread, at least, and the run length sorted by insertion */
+ #define SORT_CHUNK_BOATS 65536
+ #define SORT_INSERTION_RUN 16
+ 
+ /* Smallest block of the name arena */
+ #define NAME_BLOCK_BYTES (64 * 1024)
+ 
+ /* Name arena entries are a multiple of 8 bytes long; released ones are kept per length for reuse */
+ #define NAME_SIZE_CLASSES ((sizeof(uint64_t) + MAX_NAME_LENGTH + MAX_TAG_LENGTH + 1) / 8 + 1)
+ 
+ /* Inventory rows are formatted into a buffer of this size and written out whenever it fills */
+ #define RENDER_BUFFER_BYTES (64 * 1024)
+ #define MAX_ROW_LENGTH (MAX_NAME_LENGTH + 96)
+ 
+ /* Balances below this many cents are formatted exactly as printf("%.2f") of dollars would */
+ #define MAX_EXACT_CENTS 1000000000000000LL
+ 
+ /* Boats per page of the paged inventory until "V =<n>" changes it */
+ #define DEFAULT_PAGE_SIZE 20
+ 
+ /* Most boat counts "--bench" accepts in one run, and the largest count */
+ #define MAX_BENCH_SIZES 8
+ #define MAX_BENCH_BOATS 20000000
+ 
+ /* Boats added and then removed again by the store benchmark, at most */
+ #define BENCH_CHANGES 1000
+ 
+ /* Lines imported through (A)dd by the import benchmark, and through the old append-and-qsort path */
+ #define BENCH_IMPORT_LINES 100000
+ #define BENCH_QSORT_IMPORT_LINES 2000
+ 
+ /* Initial capacity of the boat store; it doubles whenever it fills up */
+ #define INITIAL_STORE_CAPACITY 16
+ 
+ /* Boats in the first slab of the boat pool; each new slab doubles in size */
+ #define INITIAL_SLAB_BOATS 64
+ 
+ /* Most boats suggested when a payment names no boat exactly */
+ #define MAX_SUGGESTIONS 5
+ 
+ /* Most double bookings listed after loading; the rest are only counted */
+ #define MAX_BOOKING_WARNINGS 10
+ 
+ /* Highest slip or storage space number (the largest Boat.location) */
+ #define MAX_TRACKED_PLACE 65535
+ 
+ /* Initial slot count of the name index (a power of two); it doubles at half full */
+ #define INITIAL_INDEX_CAPACITY 32
  
  /* Location types for boats */
  typedef enum {
@@ -36,53 +173,515 @@
    STORAGE
  } LocationType;
  
- /* Location-specific information */
- typedef union {
-   int slipNumber;       /* 1-85 */
-   char bayLetter;       /* A-Z */
-   char trailorTag[10];  /* License tag */
-   int storageSpace;     /* 1-50 */
- } LocationInfo;
+ /* Rates in cents per foot per month, indexed by location type */
+ static const int64_t monthlyRates[] = {SLIP_RATE, LAND_RATE, TRAILOR_RATE, STORAGE_RATE};
+ 
+ /* Boat counts "--bench" runs at when none are given */
+ static const int defaultBenchSizes[] = {1000, 100000, 1000000};
  
- /* Boat structure */
+ /* Longest trailor tag kept */
+ #define MAX_TAG_LENGTH 9
+ 
+ /*
+  * Boat structure, packed into 16 bytes; read it through the boat...() accessors.
+  * The name is interned in the store's name arena with its sort key in the 8 bytes before
+  * it and, for boats on trailors, the trailor tag in the bytes after it.
+  */
  typedef struct {
-   char name[MAX_NAME_LENGTH];
-   float length;
-   LocationType locationType;
-   LocationInfo locationInfo;
-   float amountOwed;
+   const char* name;
+   int32_t slot;         /* Index of the boat's entry in the hot columns */
+   uint8_t length;       /* Whole feet */
+   uint8_t locationType;
+   uint16_t location;    /* Slip number, storage space number or bay letter */
  } Boat;
  
+ _Static_assert(sizeof(Boat) <= 16, "Boat must stay within 16 bytes");
+ 
+ /* Block of the name arena; names never move */
+ typedef struct NameBlock {
+   struct NameBlock* next;
+   size_t used;
+   size_t size;
+   char text[] __attribute__((aligned(8)));
+ } NameBlock;
+ 
+ /* Storage for boat names, so a boat only carries a pointer to its name */
+ typedef struct {
+   NameBlock* blocks;      /* Newest block first; new names are added to it */
+   char* freeEntries[NAME_SIZE_CLASSES];   /* Released entries by length / 8, linked through their first bytes */
+ } NameArena;
+ 
+ /* Slot of a boat slab: holds a boat, or links to the next free slot */
+ typedef union BoatSlot {
+   Boat boat;
+   union BoatSlot* nextFree;
+ } BoatSlot;
+ 
+ /* Slab of boat slots allocated in one block */
+ typedef struct BoatSlab {
+   struct BoatSlab* next;
+   int capacity;
+   int used;
+   BoatSlot slots[];
+ } BoatSlab;
+ 
+ /* Slab allocator for boats with a free list of released slots */
+ typedef struct {
+   BoatSlab* slabs;      /* Newest slab first */
+   BoatSlot* freeList;
+ } BoatPool;
+ 
+ /* Hot fields of the monthly billing pass, stored column-wise and indexed by Boat.slot */
+ typedef struct {
+   int32_t* lengths;              /* Boat.length in whole feet, as saved */
+   unsigned char* locationTypes;  /* Mirrors Boat.locationType */
+   int64_t* centsOwed;            /* The only copy of each boat's balance, in cents */
+   int count;                     /* Slots handed out so far, including released ones */
+   int capacity;
+   unsigned char* dirty;          /* Set while the slot is in the store's dirty list */
+   int* freeSlots;                /* Released slots, reused before the columns grow */
+   int freeCount;
+ } HotColumns;
+ 
+ /* Month-end kernel: adds length * rate to every balance in the hot columns */
+ typedef void (*ChargeKernel)(const int32_t* lengths, const unsigned char* locationTypes,
+                              int64_t* centsOwed, int count);
+ 
+ /* Open-addressing hash index from case-folded boat names to boats, one slot per distinct name */
+ typedef struct {
+   Boat** slots;           /* A boat with the slot's name; NULL marks an empty slot */
+   unsigned int* hashes;   /* Precomputed name hash of each occupied slot */
+   int* sharers;           /* Boats with the slot's name */
+   int capacity;
+   int count;              /* Occupied slots, that is distinct names */
+ } NameIndex;
+ 
+ /* Numbered places (slips or storage spaces) in use, one bit per place */
+ typedef struct {
+   uint64_t* taken;        /* Bit n is set while place n holds at least one boat */
+   int* holders;           /* Boats assigned to each place */
+   int capacity;           /* Places tracked, a multiple of 64; it doubles on demand */
+   int places;             /* Places the marina has, searched for a free one; "F slip =<n>" changes it */
+ } Occupancy;
+ 
+ /* Open-addressing table counting the boats that use each trailor tag (entries are never removed) */
+ typedef struct {
+   char (*tags)[10];       /* Empty string marks an empty slot */
+   int* holders;
+   int capacity;
+   int count;
+ } TagIndex;
+ 
+ /* Where boats are kept: occupancy of slips and storage spaces, boats per bay and per trailor tag */
+ typedef struct {
+   Occupancy slips;
+   Occupancy storage;
+   int bayHolders[256];
+   TagIndex trailors;
+ } LocationIndex;
+ 
+ /* Write-ahead journal of the changes made since the data file was last saved */
+ typedef struct {
+   int fd;                   /* -1 while journaling is off */
+   char* path;
+   const char* dataPath;
+   char* pending;            /* Records not yet written to the journal file */
+   size_t pendingLength;
+   size_t pendingCapacity;
+   long long size;           /* Valid bytes in the journal file, -1 if there is none */
+   long long dataSize;       /* Size of the data file the journal applies to */
+ } Journal;
+ 
+ /* Rendered inventory rows, cached per hot-column slot until that boat's balance changes */
+ typedef struct {
+   char* text;               /* Cached rows back to back, including rows since invalidated */
+   size_t used;
+   size_t capacity;
+   size_t live;              /* Bytes of text still holding a slot's current row */
+   uint32_t* offsets;        /* Where each slot's row starts in text */
+   uint8_t* lengths;         /* Length of each slot's row, 0 while it has none */
+   int slots;
+ } RowCache;
+ 
+ _Static_assert(MAX_ROW_LENGTH <= UINT8_MAX, "RowCache.lengths holds row lengths in a byte");
+ 
+ /* Paged inventory view: indexes into the sorted store, moved along by inserts and removes */
+ typedef struct {
+   int first;                /* First boat of the page shown last */
+   int next;                 /* First boat of the page after it */
+   int size;                 /* Boats per page */
+ } PageCursor;
+ 
+ /* Growable array of boat pointers, kept packed and sorted by name */
+ typedef struct {
+   Boat** boats;
+   int count;
+   int capacity;
+   NameIndex index;
+   NameArena names;
+   LocationIndex locations;
+   BoatPool pool;
+   HotColumns hot;
+   Journal journal;
+   RowCache rows;
+   PageCursor page;
+   Boat** dirtyBoats;        /* Boats whose balance changed since the data file was saved */
+   int dirtyCount;
+   int dirtyCapacity;
+   int allDirty;             /* Boats were added or removed, or every balance changed */
+ } BoatStore;
+ 
+ /*
+  * Binary snapshot layout (native byte order): a SnapshotHeader, then recordCount fixed-size
+  * SnapshotRecords in name order, then the string table holding, in record order, each name
+  * followed by a NUL and, for boats on trailors, the trailor tag followed by a NUL.
+  * The checksum is the sum of hashSnapshotRecord() over the records plus the hash of the
+  * string table, so a single record can be re-checksummed without reading the others.
+  */
+ typedef struct {
+   char magic[4];
+   uint32_t version;
+   uint32_t recordCount;
+   uint32_t stringTableSize;
+   uint64_t checksum;
+   uint64_t generation;      /* Counts saves, including in-place updates, for the journal header */
+ } SnapshotHeader;
+ 
+ /* Snapshot record: the fields of a Boat, with the balance in place of the hot column slot */
+ typedef struct {
+   int64_t centsOwed;
+   uint32_t nameOffset;      /* Into the string table */
+   uint8_t length;           /* Whole feet */
+   uint8_t locationType;
+   uint16_t location;        /* Slip number, storage space number or bay letter */
+ } SnapshotRecord;
+ 
+ _Static_assert(sizeof(SnapshotRecord) == 16, "SnapshotRecord must have no padding, which would go into the checksum");
+ 
+ /* Redo log of an in-place snapshot update: this header, then recordCount SnapshotPatchEntries */
+ typedef struct {
+   char magic[4];
+   uint32_t recordCount;
+   uint64_t checksum;                /* Hash of everything after this field */
+   SnapshotHeader snapshotHeader;    /* Header of the updated snapshot */
+ } SnapshotPatchHeader;
+ 
+ typedef struct {
+   uint64_t index;                   /* Position of the record in the snapshot */
+   SnapshotRecord record;
+ } SnapshotPatchEntry;
+ 
+ /* View of a CSV field inside the loaded file (not NUL-terminated) */
+ typedef struct {
+   const char* start;
+   size_t length;
+ } FieldView;
+ 
+ /* Outcome of parsing one CSV boat record */
+ typedef enum {
+   RECORD_OK,
+   RECORD_MISSING_NAME,
+   RECORD_MISSING_LENGTH,
+   RECORD_BAD_LENGTH,
+   RECORD_MISSING_LOCATION_TYPE,
+   RECORD_BAD_LOCATION_TYPE,
+   RECORD_MISSING_LOCATION,
+   RECORD_BAD_LOCATION,
+   RECORD_MISSING_AMOUNT,
+   RECORD_OUT_OF_MEMORY
+ } RecordError;
+ 
+ /* Newline-aligned piece of a CSV file and the boats a loader thread parsed from it */
+ typedef struct {
+   const char* start;
+   const char* end;
+   Boat* boats;
+   int64_t* centsOwed;
+   NameArena names;     /* Names of the chunk's boats, handed over to the store afterwards */
+   int count;
+   int capacity;
+   int failed;          /* Ran out of memory before the end of the chunk */
+   int rejected;        /* Records skipped for a length or place number out of range */
+ } CsvChunk;
+ 
+ /* Range of boat pointers for a sorting thread: sorted alone, or two sorted halves merged */
+ typedef struct {
+   Boat** source;
+   Boat** target;
+   int begin;
+   int middle;
+   int end;
+ } SortTask;
+ 
+ /* Rendered inventory text waiting to be written to a file descriptor */
+ typedef struct {
+   char data[RENDER_BUFFER_BYTES];
+   size_t used;
+   int fd;
+ } RenderBuffer;
+ 
  /* Function prototypes */
  void displayWelcomeMessage();
  void displayExitMessage();
  void displayMenu();
- void loadBoatData(const char* filename, Boat** boats, int* boatCount);
- void saveBoatData(const char* filename, Boat** boats, int boatCount);
+ void runInteractive(BoatStore* store);
+ void runBatch(BoatStore* store, FILE* commands);
+ int executeCommand(BoatStore* store, char* command);
+ const char* mapFile(int fd, size_t* size, int* mapped);
+ void unmapFile(const char* data, size_t size, int mapped);
+ int nextField(const char** cursor, const char* end, FieldView* field);
+ int fieldEquals(FieldView field, const char* text);
+ double fieldToDouble(FieldView field);
+ double parseDecimalSlow(FieldView field);
+ int64_t fieldToCents(FieldView field);
+ int64_t parseCents(const char* text);
+ int64_t roundToCents(double amount);
+ int formatCents(char* out, size_t size, int64_t cents);
+ int fieldToInt(FieldView field);
+ RecordError parseBoatRecord(const char* line, const char* end, Boat* boat, int64_t* centsOwed, NameArena* names);
+ int storeLoadedBoat(BoatStore* store, Boat* boat, int64_t centsOwed);
+ const char* nextCsvLine(const char* cursor, const char* end, const char** lineEnd);
+ void loadCsvData(const char* data, size_t size, BoatStore* store);
+ int countLoadThreads(size_t size);
+ int loadCsvDataParallel(const char* data, size_t size, int threads, BoatStore* store);
+ int isOutOfRange(RecordError error);
+ void reportRejectedBoats(int count);
+ void* parseCsvChunk(void* argument);
+ void runInParallel(void* (*work)(void*), void* tasks, size_t taskSize, int count);
+ void sortBoats(Boat** boats, int count);
+ void mergeSortBoats(Boat** boats, Boat** scratch, int count);
+ void mergeBoatsInPlace(Boat** boats, int middle, int count);
+ void reverseBoats(Boat** boats, int count);
+ void mergeBoatRuns(Boat** source, Boat** target, int begin, int middle, int end);
+ void* sortBoatRun(void* argument);
+ void* mergeBoatRunPair(void* argument);
+ uint64_t hashBytes(const void* data, size_t size, uint64_t hash);
+ uint64_t hashSnapshotRecord(uint32_t index, const void* record, size_t size);
+ int loadSnapshot(const char* data, size_t size, BoatStore* store);
+ int isSnapshotHeader(const char* data, size_t size);
+ int readSnapshotHeader(const char* data, size_t size, SnapshotHeader* header);
+ uint64_t readSnapshotGeneration(const char* filename);
+ int loadBoatData(const char* filename, BoatStore* store);
+ int isSnapshotPath(const char* filename);
+ int saveBoatData(const char* filename, BoatStore* store);
+ int saveCsvData(const char* filename, BoatStore* store);
+ int saveSnapshot(const char* filename, BoatStore* store);
+ size_t snapshotStringsSize(const Boat* boat);
+ int saveSnapshotChanges(const char* filename, BoatStore* store);
+ int applySnapshotPatch(const char* filename);
+ int saveChanges(BoatStore* store);
+ void markBoatDirty(BoatStore* store, Boat* boat);
+ void markAllDirty(BoatStore* store);
+ void clearDirtyBoats(BoatStore* store);
+ FILE* createTempFile(const char* filename, char** tempPath);
+ int replaceWithTempFile(FILE* file, char* tempPath, const char* filename);
+ int initJournal(Journal* journal, const char* dataPath);
+ void fingerprintFile(const char* path, char* header, size_t headerSize, long long* size);
+ void replayJournal(BoatStore* store);
+ void openJournal(Journal* journal);
+ void journalAppend(Journal* journal, const char* format, ...);
+ void commitJournal(BoatStore* store);
+ void compactJournal(BoatStore* store);
+ void closeJournal(BoatStore* store);
  int compareBoats(const void* a, const void* b);
- void displayInventory(Boat** boats, int boatCount);
- void addBoat(Boat** boats, int* boatCount, const char* boatData);
- void removeBoat(Boat** boats, int* boatCount);
- void acceptPayment(Boat** boats, int boatCount);
- void updateMonthlyCharges(Boat** boats, int boatCount);
+ uint64_t foldNameKey(const char* name);
+ uint64_t boatSortKey(const Boat* boat);
+ int boatLength(const Boat* boat);
+ LocationType boatLocationType(const Boat* boat);
+ int boatSlipNumber(const Boat* boat);
+ char boatBayLetter(const Boat* boat);
+ const char* boatTrailorTag(const Boat* boat);
+ int boatStorageSpace(const Boat* boat);
+ int packLength(double length, uint8_t* packed);
+ int packPlace(int place, uint16_t* packed);
+ int compareNameKeys(uint64_t keyA, const char* nameA, uint64_t keyB, const char* nameB);
+ int compareBoatKeys(const Boat* boatA, const Boat* boatB);
+ void displayBoats(BoatStore* store, int first, int count);
+ int writeBoats(BoatStore* store, int first, int count, RenderBuffer* buffer);
+ size_t renderBoatRow(const BoatStore* store, const Boat* boat, char* out);
+ char* renderText(char* out, const char* text, size_t length, int width, int leftAlign);
+ char* renderInteger(char* out, int64_t value, int width);
+ char* renderCents(char* out, int64_t cents, int width);
+ int flushRenderBuffer(RenderBuffer* buffer);
+ size_t cachedBoatRow(BoatStore* store, const Boat* boat, char* out);
+ void cacheRow(RowCache* cache, int slot, const char* row, size_t length);
+ void invalidateRow(RowCache* cache, int slot);
+ void invalidateAllRows(RowCache* cache);
+ void displayInventory(BoatStore* store, const char* prefix);
+ void pageInventory(BoatStore* store, const char* argument);
+ void shiftPageCursor(PageCursor* page, int index, int delta);
+ void streamInventory(BoatStore* store, const char* filename);
+ int writeInventoryFile(BoatStore* store, const char* filename);
+ void reapInventoryWriters(int block);
+ int addBoat(BoatStore* store, const char* boatData);
+ void removeBoat(BoatStore* store);
+ int removeBoatByName(BoatStore* store, const char* name);
+ void reportMissingBoat(BoatStore* store, const char* name);
+ void acceptPayment(BoatStore* store);
+ int applyPayment(BoatStore* store, Boat* boat, int64_t payment);
+ void payBoatByName(BoatStore* store, const char* name, int64_t payment);
+ void updateMonthlyCharges(BoatStore* store);
+ void chargeMonthScalar(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count);
+ #ifdef HAVE_X86_KERNELS
+ void chargeMonthSSE2(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count);
+ void chargeMonthAVX2(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count);
+ void chargeMonthAVX512(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count);
+ #endif
+ ChargeKernel selectChargeKernel();
  char* locationTypeToString(LocationType type);
- int findBoatByName(Boat** boats, int boatCount, const char* name);
- void freeAllBoats(Boat** boats, int boatCount);
+ const char* internName(NameArena* arena, const char* name, size_t nameLength, const char* tag, size_t tagLength);
+ size_t nameEntrySize(size_t nameLength, const char* tag, size_t tagLength);
+ void releaseBoatName(NameArena* arena, const Boat* boat);
+ void mergeNameArenas(NameArena* into, NameArena* from);
+ void freeNameArena(NameArena* arena);
+ Boat* allocateBoat(BoatPool* pool);
+ void releaseBoat(BoatPool* pool, Boat* boat);
+ void releaseAllBoats(BoatPool* pool);
+ int growHotColumns(HotColumns* hot);
+ int attachHotSlot(HotColumns* hot, Boat* boat, int64_t centsOwed);
+ int32_t wholeFeet(float length);
+ void detachHotSlot(HotColumns* hot, Boat* boat);
+ void initBoatStore(BoatStore* store);
+ int reserveBoats(BoatStore* store, int needed);
+ int appendBoat(BoatStore* store, Boat* boat);
+ int findInsertPosition(BoatStore* store, const char* name);
+ int insertBoatAt(BoatStore* store, int index, Boat* boat);
+ void removeBoatAt(BoatStore* store, int index);
+ int findLowerBound(BoatStore* store, const char* name);
+ int findBoatIndex(BoatStore* store, const char* name);
+ int findBoatsWithPrefix(BoatStore* store, const char* prefix, int* first);
+ int indexOfBoat(BoatStore* store, Boat* boat);
+ unsigned int hashBoatName(const char* name);
+ int growNameIndex(NameIndex* index);
+ int reserveNameIndex(NameIndex* index, int names);
+ int findIndexSlot(NameIndex* index, const char* name, unsigned int hash);
+ int indexBoat(NameIndex* index, Boat* boat);
+ void unindexBoat(NameIndex* index, Boat* boat, Boat* sharer);
+ Boat* findBoatByName(BoatStore* store, const char* name);
+ int occupyPlace(Occupancy* occupancy, int place);
+ void vacatePlace(Occupancy* occupancy, int place);
+ int isPlaceFree(const Occupancy* occupancy, int place);
+ int findFreePlace(const Occupancy* occupancy, int limit);
+ int* findTagHolders(TagIndex* index, const char* tag, int create);
+ int growTagIndex(TagIndex* index);
+ int trackLocation(LocationIndex* locations, Boat* boat);
+ void untrackLocation(LocationIndex* locations, Boat* boat);
+ void reportDoubleBookings(BoatStore* store);
+ void reportLocation(BoatStore* store, char* argument);
+ void freeLocationIndex(LocationIndex* locations);
+ void freeAllBoats(BoatStore* store);
+ double nowSeconds();
+ uint64_t nextRandom(uint64_t* state);
+ int generateBoatLine(uint64_t* state, char* line);
+ char* generateCsv(int boats, size_t* size);
+ void reportBenchmark(const char* label, double seconds, double items, const char* unit);
+ int runBenchmark(const int* sizes, int sizeCount);
+ int benchmarkSize(int boats);
+ void benchmarkStore(BoatStore* store, int boats);
+ void benchmarkLookups(BoatStore* store, long long* checksum);
+ void benchmarkImport(const char* data, size_t size);
+ void benchmarkCharges(BoatStore* store);
+ void benchmarkLoadThreads(const char* data, size_t size);
+ void benchmarkSort(BoatStore* store);
+ void benchmarkFields(const char* data, size_t size, long long* checksum);
+ void benchmarkRecords(const char* data, size_t size, long long* checksum);
+ void benchmarkNames(BoatStore* store);
+ void benchmarkRecordLayout(BoatStore* store, long long* checksum);
+ void benchmarkRenderer(BoatStore* store);
+ void benchmarkRowCache(BoatStore* store);
+ void benchmarkSnapshot(BoatStore* store);
+ double benchmarkLoadFile(const char* path, int snapshot);
  
  int main(int argc, char* argv[]) {
-   Boat* boats[MAX_BOATS] = {NULL};
-   int boatCount = 0;
-   char choice;
-   char inputBuffer[256];
+   BoatStore store;
+   FILE* batchFile = NULL;
+   
+   /* Check command line arguments */
+   if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+     int sizes[MAX_BENCH_SIZES];
+     int sizeCount = argc - 2;
+     
+     for (int i = 0; i < sizeCount && i < MAX_BENCH_SIZES; i++) {
+       char* end;
+       long boats = strtol(argv[i + 2], &end, 10);
+       if (*end != '\0' || boats < 1 || boats > MAX_BENCH_BOATS) {
+         sizeCount = -1;
+         break;
+       }
+       sizes[i] = (int)boats;
+     }
+     if (sizeCount < 0 || sizeCount > MAX_BENCH_SIZES) {
+       printf("Usage: %s --bench [boats ...]\n", argv[0]);
+       return 1;
+     }
+     if (sizeCount == 0) {
+       return runBenchmark(defaultBenchSizes, (int)(sizeof(defaultBenchSizes) / sizeof(defaultBenchSizes[0])));
+     }
+     return runBenchmark(sizes, sizeCount);
+   }
+   if (argc == 4 && strcmp(argv[2], "--batch") == 0) {
+     batchFile = strcmp(argv[3], "-") == 0 ? stdin : fopen(argv[3], "r");
+     if (batchFile == NULL) {
+       printf("Error: Could not open file %s for reading.\n", argv[3]);
+       return 1;
+     }
+   } 
+   else if (argc != 2) {
+     printf("Usage: %s <filename.csv> [--batch <commands.txt|->]\n", argv[0]);
+     printf("       %s --bench [boats ...]\n", argv[0]);
+     return 1;
+   }
    
-   /* Check for correct number of command line arguments */
-   if (argc != 2) {
-     printf("Usage: %s <filename.csv>\n", argv[0]);
+   /* Load boat data from file, replaying its journal */
+   initBoatStore(&store);
+   if (!initJournal(&store.journal, argv[1])) {
+     printf("Error: Memory allocation failed.\n");
+     return 1;
+   }
+   int snapshot = loadBoatData(argv[1], &store);
+   if (snapshot == -1) {
+     /* Never overwrite a damaged file */
+     freeAllBoats(&store);
      return 1;
    }
+   if (snapshot != isSnapshotPath(argv[1])) {
+     /* Convert a CSV file given a snapshot name (or the reverse) right away */
+     if (saveBoatData(argv[1], &store)) {
+       store.journal.size = -1; /* Replayed changes are now in the file */
+       clearDirtyBoats(&store);
+     }
+   }
+   openJournal(&store.journal);
+   
+   /* Run commands from the batch file, or from the menu */
+   if (batchFile != NULL) {
+     runBatch(&store, batchFile);
+     if (batchFile != stdin) {
+       fclose(batchFile);
+     }
+   } else {
+     runInteractive(&store);
+   }
+   
+   /* Flush the journal; the data file is rewritten only when compaction is due */
+   closeJournal(&store);
+   
+   /* Display exit message */
+   if (batchFile == NULL) {
+     displayExitMessage();
+   }
    
-   /* Load boat data from file */
-   loadBoatData(argv[1], boats, &boatCount);
+   /* Let background inventory writes finish, then free allocated memory */
+   reapInventoryWriters(1);
+   freeAllBoats(&store);
+   
+   return 0;
+ }
+ 
+ /* Run the interactive menu until the user exits */
+ void runInteractive(BoatStore* store) {
+   char choice;
+   char inputBuffer[256];
    
    /* Display welcome message */
    displayWelcomeMessage();
@@ -91,54 +690,175 @@
    do {
      displayMenu();
      
-     if (fgets(inputBuffer, sizeof(inputBuffer), stdin) != NULL) {
-       choice = toupper(inputBuffer[0]);
+     if (fgets(inputBuffer, sizeof(inputBuffer), stdin) == NULL) {
+       break; /* End of input exits like X */
+     }
+     choice = toupper(inputBuffer[0]);
+     
+     switch (choice) {
+       case 'I':
+         /* An optional name prefix may follow the option, e.g. "I M" */
+         inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
+         displayInventory(store, inputBuffer[1] == ' ' ? inputBuffer + 2 : "");
+         break;
        
-       switch (choice) {
-         case 'I':
-           displayInventory(boats, boatCount);
-           break;
-         
-         case 'A':
-           printf("Please enter the boat data in CSV format                 : ");
-           if (fgets(inputBuffer, sizeof(inputBuffer), stdin) != NULL) {
-             inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
-             addBoat(boats, &boatCount, inputBuffer);
-           }
-           break;
-         
-         case 'R':
-           removeBoat(boats, &boatCount);
-           break;
-         
-         case 'P':
-           acceptPayment(boats, boatCount);
-           break;
-         
-         case 'M':
-           updateMonthlyCharges(boats, boatCount);
-           break;
-         
-         case 'X':
-           break;
-         
-         default:
-           printf("Invalid option %c\n\n", choice);
+       case 'V':
+         /* Paging arguments follow the option, e.g. "V -" or "V =50" */
+         inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
+         pageInventory(store, inputBuffer[1] == ' ' ? inputBuffer + 2 : "");
+         break;
+       
+       case 'F':
+         /* The location query follows the option, e.g. "F slip", "F slip 27" or "F slip =500" */
+         inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
+         reportLocation(store, inputBuffer[1] == ' ' ? inputBuffer + 2 : "");
+         break;
+       
+       case 'W':
+         inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
+         if (inputBuffer[1] != ' ' || inputBuffer[2] == '\0') {
+           printf("Error: Missing file name.\n\n");
            break;
-       }
+         }
+         streamInventory(store, inputBuffer + 2);
+         break;
+       
+       case 'A':
+         printf("Please enter the boat data in CSV format                 : ");
+         if (fgets(inputBuffer, sizeof(inputBuffer), stdin) != NULL) {
+           inputBuffer[strcspn(inputBuffer, "\n")] = '\0'; /* Remove newline */
+           addBoat(store, inputBuffer);
+         }
+         break;
+       
+       case 'R':
+         removeBoat(store);
+         break;
+       
+       case 'P':
+         acceptPayment(store);
+         break;
+       
+       case 'M':
+         updateMonthlyCharges(store);
+         printf("\n");
+         break;
+       
+       case 'X':
+         break;
+       
+       default:
+         printf("Invalid option %c\n\n", choice);
+         break;
      }
+     
+     /* Make each change durable before the next prompt */
+     commitJournal(store);
    } while (choice != 'X');
+ }
+ 
+ /* Run batch commands, one per line, without prompts */
+ void runBatch(BoatStore* store, FILE* commands) {
+   char* line = NULL;
+   size_t lineCapacity = 0;
+   int uncommitted = 0;
    
-   /* Save boat data to file */
-   saveBoatData(argv[1], boats, boatCount);
+   while (getline(&line, &lineCapacity, commands) != -1) {
+     if (!executeCommand(store, line)) {
+       break;
+     }
+     
+     /* Flush the journal to disk once per group of commands */
+     if (++uncommitted == JOURNAL_BATCH_COMMANDS) {
+       commitJournal(store);
+       uncommitted = 0;
+     }
+   }
    
-   /* Display exit message */
-   displayExitMessage();
+   commitJournal(store);
+   free(line);
+ }
+ 
+ /* Execute one batch command line (returns 0 when it asks to exit) */
+ int executeCommand(BoatStore* store, char* command) {
+   command[strcspn(command, "\r\n")] = '\0'; /* Remove newline */
    
-   /* Free allocated memory */
-   freeAllBoats(boats, boatCount);
+   char choice = toupper(command[0]);
+   char* argument = command[0] == '\0' ? command : command + 1;
+   /* Exactly one separator, so arguments starting with spaces (journaled names) survive */
+   if (*argument == ' ' || *argument == '\t') {
+     argument++;
+   }
    
-   return 0;
+   switch (choice) {
+     case '\0':
+     case '#':
+       break;
+     
+     case 'I':
+       displayInventory(store, argument);
+       break;
+     
+     case 'A':
+       addBoat(store, argument);
+       break;
+     
+     case 'R':
+       removeBoatByName(store, argument);
+       break;
+     
+     case 'P': {
+       /* Boat names cannot contain commas, so the last comma starts the amount */
+       char* comma = strrchr(argument, ',');
+       if (comma == NULL) {
+         printf("Error: Invalid payment format.\n\n");
+         break;
+       }
+       *comma = '\0';
+       payBoatByName(store, argument, parseCents(comma + 1));
+       break;
+     }
+     
+     case 'M':
+       updateMonthlyCharges(store);
+       break;
+     
+     case 'S':
+       if (strcmp(argument, store->journal.dataPath) == 0) {
+         /* Saving the data file itself folds the journal into it */
+         commitJournal(store);
+         compactJournal(store);
+       } else {
+         /* Save a copy, e.g. export a snapshot to CSV */
+         saveBoatData(argument, store);
+       }
+       break;
+     
+     case 'F':
+       reportLocation(store, argument);
+       break;
+     
+     case 'V':
+       pageInventory(store, argument);
+       break;
+     
+     case 'W':
+       if (argument[0] == '\0') {
+         printf("Error: Missing file name.\n\n");
+         break;
+       }
+       streamInventory(store, argument);
+       break;
+     
+     case 'X':
+       return 0;
+     
+     default:
+       printf("Invalid option %c\n\n", choice);
+       break;
+   }
+   
+   return 1;
  }
  
  /* Display welcome message */
@@ -157,455 +877,3669 @@
    printf("(I)nventory, (A)dd, (R)emove, (P)ayment, (M)onth, e(X)it : ");
  }
  
- /* Load boat data from CSV file */
- void loadBoatData(const char* filename, Boat** boats, int* boatCount) {
-   FILE* file = fopen(filename, "r");
-   char buffer[256];
-   
-   /* Check if file opened successfully */
-   if (file == NULL) {
-     printf("Warning: Could not open file %s for reading.\n", filename);
-     return;
-   }
+ /* Map a whole file into memory for reading; falls back to read() when mmap is unavailable */
+ const char* mapFile(int fd, size_t* size, int* mapped) {
+   struct stat st;
+   char* data = NULL;
+   size_t capacity = 0;
+   ssize_t bytesRead;
    
-   *boatCount = 0;
+   *size = 0;
+   *mapped = 0;
    
-   /* Read each line from file */
-   while (fgets(buffer, sizeof(buffer), file) != NULL && *boatCount < MAX_BOATS) {
-     buffer[strcspn(buffer, "\n")] = '\0'; /* Remove newline */
-     
-     /* Allocate memory for new boat */
-     Boat* newBoat = (Boat*)malloc(sizeof(Boat));
-     if (newBoat == NULL) {
-       printf("Error: Memory allocation failed.\n");
-       continue;
-     }
-     
-     /* Parse CSV line */
-     char* token;
-     char* rest = buffer;
-     
-     /* Parse boat name */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       continue;
+   /* Regular, non-empty files are mapped directly */
+   if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+     void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+     if (view != MAP_FAILED) {
+       madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+       *size = (size_t)st.st_size;
+       *mapped = 1;
+       return view;
      }
-     strncpy(newBoat->name, token, MAX_NAME_LENGTH - 1);
-     newBoat->name[MAX_NAME_LENGTH - 1] = '\0';
-     
-     /* Parse boat length */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       continue;
-     }
-     newBoat->length = atof(token);
-     
-     /* Parse location type */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       continue;
-     }
-     
-     if (strcmp(token, "slip") == 0) {
-       newBoat->locationType = SLIP;
-       
-       /* Parse slip number */
-       token = strtok_r(rest, ",", &rest);
-       if (token == NULL) {
-         free(newBoat);
-         continue;
-       }
-       newBoat->locationInfo.slipNumber = atoi(token);
-     } 
-     else if (strcmp(token, "land") == 0) {
-       newBoat->locationType = LAND;
-       
-       /* Parse bay letter */
-       token = strtok_r(rest, ",", &rest);
-       if (token == NULL || strlen(token) == 0) {
-         free(newBoat);
-         continue;
-       }
-       newBoat->locationInfo.bayLetter = token[0];
-     } 
-     else if (strcmp(token, "trailor") == 0) {
-       newBoat->locationType = TRAILOR;
-       
-       /* Parse trailor tag */
-       token = strtok_r(rest, ",", &rest);
-       if (token == NULL) {
-         free(newBoat);
-         continue;
-       }
-       strncpy(newBoat->locationInfo.trailorTag, token, 9);
-       newBoat->locationInfo.trailorTag[9] = '\0';
-     } 
-     else if (strcmp(token, "storage") == 0) {
-       newBoat->locationType = STORAGE;
-       
-       /* Parse storage space number */
-       token = strtok_r(rest, ",", &rest);
-       if (token == NULL) {
-         free(newBoat);
-         continue;
+   }
+   
+   /* Pipes and other special files are read into a heap buffer */
+   do {
+     if (*size == capacity) {
+       capacity = capacity == 0 ? 65536 : capacity * 2;
+       char* grown = (char*)realloc(data, capacity);
+       if (grown == NULL) {
+         free(data);
+         *size = 0;
+         return NULL;
        }
-       newBoat->locationInfo.storageSpace = atoi(token);
-     } 
-     else {
-       /* Invalid location type */
-       free(newBoat);
-       continue;
+       data = grown;
      }
-     
-     /* Parse amount owed */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       continue;
+     bytesRead = read(fd, data + *size, capacity - *size);
+     if (bytesRead > 0) {
+       *size += (size_t)bytesRead;
      }
-     newBoat->amountOwed = atof(token);
-     
-     /* Add boat to array */
-     boats[*boatCount] = newBoat;
-     (*boatCount)++;
-   }
-   
-   /* Close file */
-   fclose(file);
+   } while (bytesRead > 0);
    
-   /* Sort boats by name */
-   qsort(boats, *boatCount, sizeof(Boat*), compareBoats);
+   return data;
+ }
+ 
+ /* Release memory obtained from mapFile() */
+ void unmapFile(const char* data, size_t size, int mapped) {
+   if (mapped) {
+     munmap((void*)data, size);
+   } else {
+     free((void*)data);
+   }
  }
  
- /* Save boat data to CSV file */
- void saveBoatData(const char* filename, Boat** boats, int boatCount) {
-   FILE* file = fopen(filename, "w");
+ /* Get the next comma separated field of a line (empty fields are skipped, as strtok does) */
+ int nextField(const char** cursor, const char* end, FieldView* field) {
+   const char* start = *cursor;
    
-   /* Check if file opened successfully */
-   if (file == NULL) {
-     printf("Error: Could not open file %s for writing.\n", filename);
-     return;
+   while (start < end && *start == ',') {
+     start++;
+   }
+   if (start == end) {
+     return 0;
    }
    
-   /* Write each boat to file */
-   for (int i = 0; i < boatCount; i++) {
-     Boat* boat = boats[i];
-     
-     fprintf(file, "%s,%.0f,%s,", 
-             boat->name, 
-             boat->length,
-             locationTypeToString(boat->locationType));
-     
-     /* Write location-specific information */
-     switch (boat->locationType) {
-       case SLIP:
-         fprintf(file, "%d", boat->locationInfo.slipNumber);
-         break;
-       case LAND:
-         fprintf(file, "%c", boat->locationInfo.bayLetter);
-         break;
-       case TRAILOR:
-         fprintf(file, "%s", boat->locationInfo.trailorTag);
-         break;
-       case STORAGE:
-         fprintf(file, "%d", boat->locationInfo.storageSpace);
-         break;
-     }
-     
-     /* Write amount owed */
-     fprintf(file, ",%.2f\n", boat->amountOwed);
+   const char* stop = memchr(start, ',', (size_t)(end - start));
+   if (stop == NULL) {
+     stop = end;
    }
    
-   /* Close file */
-   fclose(file);
+   field->start = start;
+   field->length = (size_t)(stop - start);
+   *cursor = stop;
+   return 1;
  }
  
- /* Compare boats by name (for qsort) */
- int compareBoats(const void* a, const void* b) {
-   Boat* boatA = *(Boat**)a;
-   Boat* boatB = *(Boat**)b;
-   
-   return strcasecmp(boatA->name, boatB->name);
+ /* Check whether a field holds exactly the given text, ignoring case */
+ int fieldEquals(FieldView field, const char* text) {
+   return field.length == strlen(text) && strncasecmp(field.start, text, field.length) == 0;
  }
  
- /* Display inventory of boats */
- void displayInventory(Boat** boats, int boatCount) {
-   for (int i = 0; i < boatCount; i++) {
-     Boat* boat = boats[i];
-     
-     printf("%-20s %3.0f' ", boat->name, boat->length);
-     
-     /* Display location-specific information */
-     switch (boat->locationType) {
-       case SLIP:
-         printf("%8s   # %2d", "slip", boat->locationInfo.slipNumber);
-         break;
-       case LAND:
-         printf("%8s      %c", "land", boat->locationInfo.bayLetter);
-         break;
-       case TRAILOR:
-         printf("%8s %6s", "trailor", boat->locationInfo.trailorTag);
-         break;
-       case STORAGE:
-         printf("%8s   # %2d", "storage", boat->locationInfo.storageSpace);
-         break;
+ /* Convert a numeric field to a double, reading plain decimals like "12" or "-1234.56" directly */
+ double fieldToDouble(FieldView field) {
+   static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                        1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+   const char* cursor = field.start;
+   const char* end = field.start + field.length;
+   uint64_t mantissa = 0;
+   int digits = 0;
+   int fractionDigits = 0;
+   int negative = cursor < end && *cursor == '-';
+   
+   if (negative) {
+     cursor++;
+   }
+   for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, digits++) {
+     mantissa = mantissa * 10 + (uint64_t)(*cursor - '0');
+   }
+   if (cursor < end && *cursor == '.') {
+     for (cursor++; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, digits++, fractionDigits++) {
+       mantissa = mantissa * 10 + (uint64_t)(*cursor - '0');
      }
-     
-     /* Display amount owed */
-     printf("   Owes $%7.2f\n", boat->amountOwed);
    }
    
-   printf("\n");
+   /* Up to 15 digits are exact in a double, so one division rounds like atof; anything else goes the slow way */
+   if (cursor != end || digits == 0 || digits > 15) {
+     return parseDecimalSlow(field);
+   }
+   
+   double value = (double)mantissa / powersOfTen[fractionDigits];
+   return negative ? -value : value;
  }
  
- /* Add a boat to the inventory */
- void addBoat(Boat** boats, int* boatCount, const char* boatData) {
-   /* Check if maximum boats reached */
-   if (*boatCount >= MAX_BOATS) {
-     printf("Error: Maximum number of boats reached.\n\n");
-     return;
+ /* Convert an unusual numeric field (exponent, spaces, many digits) through atof */
+ double parseDecimalSlow(FieldView field) {
+   char number[32];
+   size_t length = field.length < sizeof(number) - 1 ? field.length : sizeof(number) - 1;
+   
+   memcpy(number, field.start, length);
+   number[length] = '\0';
+   return atof(number);
+ }
+ 
+ /* Convert a money field to whole cents (clamped to MAX_CENTS), reading amounts like "12.5" directly */
+ int64_t fieldToCents(FieldView field) {
+   const char* cursor = field.start;
+   const char* end = field.start + field.length;
+   int64_t cents = 0;
+   int digits = 0;
+   int fractionDigits = 0;
+   int negative = cursor < end && *cursor == '-';
+   
+   if (negative) {
+     cursor++;
+   }
+   for (; cursor < end && *cursor >= '0' && *cursor <= '9' && digits < 16; cursor++, digits++) {
+     cents = cents * 10 + (*cursor - '0');
+   }
+   if (cursor < end && *cursor == '.') {
+     for (cursor++; cursor < end && *cursor >= '0' && *cursor <= '9' && fractionDigits < 2; cursor++, fractionDigits++) {
+       cents = cents * 10 + (*cursor - '0');
+     }
    }
    
-   /* Allocate memory for new boat */
-   Boat* newBoat = (Boat*)malloc(sizeof(Boat));
-   if (newBoat == NULL) {
-     printf("Error: Memory allocation failed.\n\n");
-     return;
+   /* Anything else, such as a third decimal, is rounded to the nearest cent */
+   if (cursor != end || digits + fractionDigits == 0) {
+     return roundToCents(parseDecimalSlow(field));
+   }
+   
+   for (; fractionDigits < 2; fractionDigits++) {
+     cents *= 10;
+   }
+   if (cents > MAX_CENTS) {
+     cents = MAX_CENTS;
    }
+   return negative ? -cents : cents;
+ }
+ 
+ /* Convert a NUL-terminated amount, such as a typed payment, to whole cents */
+ int64_t parseCents(const char* text) {
+   FieldView field;
    
-   /* Parse CSV line */
-   char buffer[256];
-   strncpy(buffer, boatData, sizeof(buffer) - 1);
-   buffer[sizeof(buffer) - 1] = '\0';
+   field.start = text;
+   field.length = strcspn(text, "\r\n");
+   return fieldToCents(field);
+ }
+ 
+ /* Round an amount in dollars to the nearest cent, halves away from zero, clamped to MAX_CENTS */
+ int64_t roundToCents(double amount) {
+   double cents = amount * 100.0;
    
-   char* token;
-   char* rest = buffer;
+   if (!(cents > -(double)MAX_CENTS && cents < (double)MAX_CENTS)) {
+     return cents > 0 ? MAX_CENTS : cents < 0 ? -MAX_CENTS : 0; /* Out of range or NaN */
+   }
    
-   /* Parse boat name */
-   token = strtok_r(rest, ",", &rest);
-   if (token == NULL) {
-     free(newBoat);
-     printf("Error: Invalid boat data format.\n\n");
-     return;
+   int64_t rounded = (int64_t)(cents < 0 ? cents - 0.5 : cents + 0.5);
+   return rounded > MAX_CENTS ? MAX_CENTS : rounded < -MAX_CENTS ? -MAX_CENTS : rounded;
+ }
+ 
+ /* Write cents as dollars with two decimals, like "%.2f" but exact for every balance */
+ int formatCents(char* out, size_t size, int64_t cents) {
+   unsigned long long magnitude = cents < 0 ? 0 - (unsigned long long)cents : (unsigned long long)cents;
+   
+   return snprintf(out, size, "%s%llu.%02llu", cents < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+ }
+ 
+ /* Convert a field holding a small whole number, such as a slip or storage number, the way atoi reads it */
+ int fieldToInt(FieldView field) {
+   const char* cursor = field.start;
+   const char* end = field.start + field.length;
+   long long value = 0;
+   
+   /* strtol rules: leading spaces, an optional sign, then digits up to anything else ("1e1" is 1) */
+   while (cursor < end && isspace((unsigned char)*cursor)) {
+     cursor++;
+   }
+   int negative = cursor < end && *cursor == '-';
+   if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+     cursor++;
+   }
+   for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++) {
+     value = value * 10 + (*cursor - '0');
+     if (value > (long long)INT_MAX + 1) {
+       value = (long long)INT_MAX + 1; /* Clamp instead of overflowing */
+     }
+   }
+   
+   if (negative) {
+     value = -value;
+   }
+   return value > INT_MAX ? INT_MAX : (int)value;
+ }
+ 
+ /* Parse one CSV record into caller-provided storage, reading the fields in place (no allocation) */
+ RecordError parseBoatRecord(const char* line, const char* end, Boat* boat, int64_t* centsOwed, NameArena* names) {
+   FieldView field;
+   const char* cursor = line;
+   
+   /* Parse boat name; it is copied into the arena once the whole record is valid */
+   if (!nextField(&cursor, end, &field)) {
+     return RECORD_MISSING_NAME;
    }
-   strncpy(newBoat->name, token, MAX_NAME_LENGTH - 1);
-   newBoat->name[MAX_NAME_LENGTH - 1] = '\0';
+   FieldView name = field;
    
    /* Parse boat length */
-   token = strtok_r(rest, ",", &rest);
-   if (token == NULL) {
-     free(newBoat);
-     printf("Error: Invalid boat data format.\n\n");
-     return;
+   if (!nextField(&cursor, end, &field)) {
+     return RECORD_MISSING_LENGTH;
+   }
+   if (!packLength(fieldToDouble(field), &boat->length)) {
+     return RECORD_BAD_LENGTH;
    }
-   newBoat->length = atof(token);
    
    /* Parse location type */
-   token = strtok_r(rest, ",", &rest);
-   if (token == NULL) {
-     free(newBoat);
-     printf("Error: Invalid boat data format.\n\n");
-     return;
+   if (!nextField(&cursor, end, &field)) {
+     return RECORD_MISSING_LOCATION_TYPE;
    }
    
-   if (strcasecmp(token, "slip") == 0) {
-     newBoat->locationType = SLIP;
-     
-     /* Parse slip number */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       printf("Error: Invalid boat data format.\n\n");
-       return;
-     }
-     newBoat->locationInfo.slipNumber = atoi(token);
+   if (fieldEquals(field, "slip")) {
+     boat->locationType = SLIP;
    } 
-   else if (strcasecmp(token, "land") == 0) {
-     newBoat->locationType = LAND;
-     
-     /* Parse bay letter */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL || strlen(token) == 0) {
-       free(newBoat);
-       printf("Error: Invalid boat data format.\n\n");
-       return;
-     }
-     newBoat->locationInfo.bayLetter = token[0];
+   else if (fieldEquals(field, "land")) {
+     boat->locationType = LAND;
    } 
-   else if (strcasecmp(token, "trailor") == 0) {
-     newBoat->locationType = TRAILOR;
-     
-     /* Parse trailor tag */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       printf("Error: Invalid boat data format.\n\n");
-       return;
-     }
-     strncpy(newBoat->locationInfo.trailorTag, token, 9);
-     newBoat->locationInfo.trailorTag[9] = '\0';
+   else if (fieldEquals(field, "trailor")) {
+     boat->locationType = TRAILOR;
    } 
-   else if (strcasecmp(token, "storage") == 0) {
-     newBoat->locationType = STORAGE;
-     
-     /* Parse storage space number */
-     token = strtok_r(rest, ",", &rest);
-     if (token == NULL) {
-       free(newBoat);
-       printf("Error: Invalid boat data format.\n\n");
-       return;
-     }
-     newBoat->locationInfo.storageSpace = atoi(token);
+   else if (fieldEquals(field, "storage")) {
+     boat->locationType = STORAGE;
    } 
    else {
-     /* Invalid location type */
-     free(newBoat);
-     printf("Error: Invalid location type.\n\n");
-     return;
+     return RECORD_BAD_LOCATION_TYPE;
+   }
+   
+   /* Parse location-specific information */
+   if (!nextField(&cursor, end, &field)) {
+     return RECORD_MISSING_LOCATION;
+   }
+   
+   FieldView tag = {NULL, 0};
+   switch (boat->locationType) {
+     case SLIP:
+     case STORAGE:
+       if (!packPlace(fieldToInt(field), &boat->location)) {
+         return RECORD_BAD_LOCATION;
+       }
+       break;
+     case LAND:
+       boat->location = (unsigned char)field.start[0];
+       break;
+     case TRAILOR:
+       boat->location = 0;
+       tag.start = field.start;
+       tag.length = field.length < MAX_TAG_LENGTH ? field.length : MAX_TAG_LENGTH;
+       break;
    }
    
    /* Parse amount owed */
-   token = strtok_r(rest, ",", &rest);
-   if (token == NULL) {
-     free(newBoat);
-     printf("Error: Invalid boat data format.\n\n");
+   if (!nextField(&cursor, end, &field)) {
+     return RECORD_MISSING_AMOUNT;
+   }
+   *centsOwed = fieldToCents(field);
+   
+   boat->name = internName(names, name.start, name.length < MAX_NAME_LENGTH - 1 ? name.length : MAX_NAME_LENGTH - 1,
+                           tag.start, tag.length);
+   if (boat->name == NULL) {
+     return RECORD_OUT_OF_MEMORY;
+   }
+   
+   return RECORD_OK;
+ }
+ 
+ /* Add a freshly loaded boat at the end of the store (releases it and returns 0 on failure) */
+ int storeLoadedBoat(BoatStore* store, Boat* boat, int64_t centsOwed) {
+   if (!attachHotSlot(&store->hot, boat, centsOwed)) {
+     releaseBoat(&store->pool, boat);
+     return 0;
+   }
+   
+   if (!appendBoat(store, boat)) {
+     detachHotSlot(&store->hot, boat);
+     releaseBoat(&store->pool, boat);
+     return 0;
+   }
+   
+   return 1;
+ }
+ 
+ /* Find the end of the line at the cursor, without its line break, and return where the next line starts */
+ const char* nextCsvLine(const char* cursor, const char* end, const char** lineEnd) {
+   const char* next;
+   
+   *lineEnd = memchr(cursor, '\n', (size_t)(end - cursor));
+   if (*lineEnd == NULL) {
+     *lineEnd = end;
+     next = end;
+   } else {
+     next = *lineEnd + 1;
+   }
+   if (*lineEnd > cursor && (*lineEnd)[-1] == '\r') {
+     (*lineEnd)--;
+   }
+   
+   return next;
+ }
+ 
+ /* Load boats from CSV text */
+ void loadCsvData(const char* data, size_t size, BoatStore* store) {
+   const char* cursor = data;
+   const char* end = data + size;
+   int threads = countLoadThreads(size);
+   int rejected = 0;
+   
+   if (threads > 1) {
+     reportRejectedBoats(loadCsvDataParallel(data, size, threads, store));
+     sortBoats(store->boats, store->count);
      return;
    }
-   newBoat->amountOwed = atof(token);
    
-   /* Add boat to array */
-   boats[*boatCount] = newBoat;
-   (*boatCount)++;
+   /* Parse each line of the file */
+   while (cursor < end) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     
+     /* Allocate memory for new boat */
+     Boat* newBoat = allocateBoat(&store->pool);
+     if (newBoat == NULL) {
+       printf("Error: Memory allocation failed.\n");
+       break;
+     }
+     
+     int64_t centsOwed;
+     RecordError error = parseBoatRecord(cursor, lineEnd, newBoat, &centsOwed, &store->names);
+     if (error != RECORD_OK) {
+       releaseBoat(&store->pool, newBoat);
+       if (error == RECORD_OUT_OF_MEMORY) {
+         printf("Error: Memory allocation failed.\n");
+         break;
+       }
+       rejected += isOutOfRange(error);
+     } 
+     else if (!storeLoadedBoat(store, newBoat, centsOwed)) {
+       printf("Error: Memory allocation failed.\n");
+       break;
+     }
+     
+     cursor = next;
+   }
    
    /* Sort boats by name */
-   qsort(boats, *boatCount, sizeof(Boat*), compareBoats);
+   reportRejectedBoats(rejected);
+   sortBoats(store->boats, store->count);
  }
  
- /* Remove a boat from the inventory */
- void removeBoat(Boat** boats, int* boatCount) {
-   char name[MAX_NAME_LENGTH];
+ /* Whether a record was refused for a length or place number that a boat record cannot hold */
+ int isOutOfRange(RecordError error) {
+   return error == RECORD_BAD_LENGTH || error == RECORD_BAD_LOCATION;
+ }
+ 
+ /* Warn about boats left out of a load, which saving the file would drop */
+ void reportRejectedBoats(int count) {
+   if (count > 0) {
+     printf("Warning: Skipped %d boats with a length or slip/storage number out of range; "
+            "saving the file will drop them.\n", count);
+   }
+ }
+ 
+ /* Choose how many threads parse a CSV file of the given size */
+ int countLoadThreads(size_t size) {
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   size_t threads = size / LOAD_CHUNK_BYTES;
    
-   printf("Please enter the boat name                               : ");
-   if (fgets(name, sizeof(name), stdin) != NULL) {
-     name[strcspn(name, "\n")] = '\0'; /* Remove newline */
+   if (cores < 1) {
+     cores = 1;
+   }
+   if (threads > (size_t)cores) {
+     threads = (size_t)cores;
+   }
+   if (threads > MAX_LOAD_THREADS) {
+     threads = MAX_LOAD_THREADS;
+   }
+   
+   return threads < 1 ? 1 : (int)threads;
+ }
+ 
+ /*
+  * Parse newline-aligned chunks of CSV text on several threads, then add the boats in file order.
+  * Returns the number of records skipped for a length or place number out of range.
+  */
+ int loadCsvDataParallel(const char* data, size_t size, int threads, BoatStore* store) {
+   CsvChunk chunks[MAX_LOAD_THREADS];
+   const char* end = data + size;
+   const char* cursor = data;
+   
+   /* Split at the first line break after each even share of the file */
+   for (int i = 0; i < threads; i++) {
+     const char* stop = i == threads - 1 ? end : data + size / (size_t)threads * (size_t)(i + 1);
+     if (stop < cursor) {
+       stop = cursor;
+     }
+     if (stop < end) {
+       const char* lineBreak = memchr(stop, '\n', (size_t)(end - stop));
+       stop = lineBreak == NULL ? end : lineBreak + 1;
+     }
      
-     /* Find boat index */
-     int index = findBoatByName(boats, *boatCount, name);
+     memset(&chunks[i], 0, sizeof(chunks[i]));
+     chunks[i].start = cursor;
+     chunks[i].end = stop;
+     cursor = stop;
+   }
+   
+   runInParallel(parseCsvChunk, chunks, sizeof(CsvChunk), threads);
+   
+   /* The pool and the store are not shared between threads, so boats are added here */
+   int failed = 0;
+   int rejected = 0;
+   for (int i = 0; i < threads; i++) {
+     CsvChunk* chunk = &chunks[i];
      
-     if (index == -1) {
-       printf("No boat with that name\n\n");
-       return;
+     failed = failed || !reserveBoats(store, store->count + chunk->count);
+     for (int j = 0; j < chunk->count && !failed; j++) {
+       Boat* newBoat = allocateBoat(&store->pool);
+       if (newBoat == NULL) {
+         failed = 1;
+         break;
+       }
+       
+       *newBoat = chunk->boats[j];
+       failed = !storeLoadedBoat(store, newBoat, chunk->centsOwed[j]);
      }
+     failed = failed || chunk->failed;
+     rejected += chunk->rejected;
      
-     /* Free boat memory */
-     free(boats[index]);
+     free(chunk->boats);
+     free(chunk->centsOwed);
+     mergeNameArenas(&store->names, &chunk->names);
+   }
+   
+   if (failed) {
+     printf("Error: Memory allocation failed.\n");
+   }
+   return rejected;
+ }
+ 
+ /* Loader thread: parse the lines of one chunk into boats owned by the chunk */
+ void* parseCsvChunk(void* argument) {
+   CsvChunk* chunk = (CsvChunk*)argument;
+   const char* cursor = chunk->start;
+   
+   while (cursor < chunk->end) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, chunk->end, &lineEnd);
      
-     /* Shift remaining boats */
-     for (int i = index; i < *boatCount - 1; i++) {
-       boats[i] = boats[i + 1];
+     /* Make room for one more boat */
+     if (chunk->count == chunk->capacity) {
+       int capacity = chunk->capacity == 0 ? INITIAL_SLAB_BOATS : chunk->capacity * 2;
+       Boat* boats = (Boat*)realloc(chunk->boats, (size_t)capacity * sizeof(Boat));
+       if (boats != NULL) {
+         chunk->boats = boats;
+       }
+       int64_t* centsOwed = (int64_t*)realloc(chunk->centsOwed, (size_t)capacity * sizeof(int64_t));
+       if (centsOwed != NULL) {
+         chunk->centsOwed = centsOwed;
+       }
+       if (boats == NULL || centsOwed == NULL) {
+         chunk->failed = 1;
+         break;
+       }
+       chunk->capacity = capacity;
      }
      
-     /* Update boat count */
-     (*boatCount)--;
+     RecordError error = parseBoatRecord(cursor, lineEnd, &chunk->boats[chunk->count], &chunk->centsOwed[chunk->count],
+                                         &chunk->names);
+     if (error == RECORD_OK) {
+       chunk->count++;
+     } 
+     else if (error == RECORD_OUT_OF_MEMORY) {
+       chunk->failed = 1;
+       break;
+     } else {
+       chunk->rejected += isOutOfRange(error);
+     }
+     cursor = next;
    }
+   
+   return NULL;
  }
  
- /* Accept payment for a boat */
- void acceptPayment(Boat** boats, int boatCount) {
-   char name[MAX_NAME_LENGTH];
-   float payment;
+ /* Run one task per thread, the first on the calling thread, and wait for all of them */
+ void runInParallel(void* (*work)(void*), void* tasks, size_t taskSize, int count) {
+   pthread_t workers[MAX_LOAD_THREADS];
+   int started[MAX_LOAD_THREADS];
+   char* task = (char*)tasks;
    
-   printf("Please enter the boat name                               : ");
-   if (fgets(name, sizeof(name), stdin) != NULL) {
-     name[strcspn(name, "\n")] = '\0'; /* Remove newline */
+   for (int i = 1; i < count; i++) {
+     started[i] = pthread_create(&workers[i], NULL, work, task + (size_t)i * taskSize) == 0;
+   }
+   work(task);
+   
+   /* Tasks whose thread could not be started run here */
+   for (int i = 1; i < count; i++) {
+     if (started[i]) {
+       pthread_join(workers[i], NULL);
+     } else {
+       work(task + (size_t)i * taskSize);
+     }
+   }
+ }
+ 
+ /* Sort boats by name, keeping boats with equal names in their current order */
+ void sortBoats(Boat** boats, int count) {
+   SortTask tasks[MAX_LOAD_THREADS];
+   int bounds[MAX_LOAD_THREADS + 1];
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   int runs = count / SORT_CHUNK_BOATS;
+   
+   if (count < 2) {
+     return;
+   }
+   
+   /* qsort is not stable, so without scratch memory merge in place instead, on this thread */
+   Boat** scratch = (Boat**)malloc((size_t)count * sizeof(Boat*));
+   if (scratch == NULL) {
+     mergeSortBoats(boats, NULL, count);
+     return;
+   }
+   
+   if (runs > cores) {
+     runs = (int)cores;
+   }
+   if (runs > MAX_LOAD_THREADS) {
+     runs = MAX_LOAD_THREADS;
+   }
+   if (runs < 2) {
+     mergeSortBoats(boats, scratch, count);
+     free(scratch);
+     return;
+   }
+   
+   /* Sort one run per thread */
+   for (int i = 0; i <= runs; i++) {
+     bounds[i] = (int)((long long)count * i / runs);
+   }
+   for (int i = 0; i < runs; i++) {
+     tasks[i].source = boats;
+     tasks[i].target = scratch;
+     tasks[i].begin = bounds[i];
+     tasks[i].end = bounds[i + 1];
+   }
+   runInParallel(sortBoatRun, tasks, sizeof(SortTask), runs);
+   
+   /* Merge neighbouring runs in pairs, alternating between the two arrays, until one is left */
+   Boat** source = boats;
+   Boat** target = scratch;
+   while (runs > 1) {
+     int pairs = runs / 2;
      
-     /* Find boat index */
-     int index = findBoatByName(boats, boatCount, name);
+     for (int i = 0; i < pairs; i++) {
+       tasks[i].source = source;
+       tasks[i].target = target;
+       tasks[i].begin = bounds[2 * i];
+       tasks[i].middle = bounds[2 * i + 1];
+       tasks[i].end = bounds[2 * i + 2];
+     }
+     runInParallel(mergeBoatRunPair, tasks, sizeof(SortTask), pairs);
      
-     if (index == -1) {
-       printf("No boat with that name\n\n");
-       return;
+     /* An odd run out is carried over unchanged */
+     if (runs % 2 == 1) {
+       memcpy(target + bounds[runs - 1], source + bounds[runs - 1],
+              (size_t)(bounds[runs] - bounds[runs - 1]) * sizeof(Boat*));
+     }
+     for (int i = 0; i <= pairs; i++) {
+       bounds[i] = bounds[2 * i];
      }
+     bounds[(runs + 1) / 2] = count;
+     runs = (runs + 1) / 2;
      
-     printf("Please enter the amount to be paid                       : ");
-     char buffer[50];
-     if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-       payment = atof(buffer);
-       
-       /* Check if payment amount is valid */
-       if (payment > boats[index]->amountOwed) {
-         printf("That is more than the amount owed, $%.2f\n\n", boats[index]->amountOwed);
-         return;
+     Boat** swap = source;
+     source = target;
+     target = swap;
+   }
+   
+   if (source != boats) {
+     memcpy(boats, source, (size_t)count * sizeof(Boat*));
+   }
+   free(scratch);
+ }
+ 
+ /* Stable merge sort of boat pointers by name, using scratch space of the same size (or, slower, none) */
+ void mergeSortBoats(Boat** boats, Boat** scratch, int count) {
+   /* Sort short ranges by insertion */
+   if (count <= SORT_INSERTION_RUN) {
+     for (int i = 1; i < count; i++) {
+       Boat* boat = boats[i];
+       int j = i;
+       while (j > 0 && compareBoatKeys(boats[j - 1], boat) > 0) {
+         boats[j] = boats[j - 1];
+         j--;
        }
-       
-       /* Update amount owed */
-       boats[index]->amountOwed -= payment;
+       boats[j] = boat;
+     }
+     return;
+   }
+   
+   /* Sort the halves depth first, so small ranges are merged while their boats are still cached */
+   int middle = count / 2;
+   mergeSortBoats(boats, scratch, middle);
+   mergeSortBoats(boats + middle, scratch != NULL ? scratch + middle : NULL, count - middle);
+   if (scratch == NULL) {
+     mergeBoatsInPlace(boats, middle, count);
+     return;
+   }
+   
+   /* Move the left half aside and merge both halves back into place, taking from the left on ties */
+   memcpy(scratch, boats, (size_t)middle * sizeof(Boat*));
+   int left = 0;
+   int right = middle;
+   int out = 0;
+   while (left < middle && right < count) {
+     if (compareBoatKeys(boats[right], scratch[left]) < 0) {
+       boats[out++] = boats[right++];
+     } else {
+       boats[out++] = scratch[left++];
      }
    }
+   memcpy(boats + out, scratch + left, (size_t)(middle - left) * sizeof(Boat*));
  }
  
- /* Update monthly charges for all boats */
- void updateMonthlyCharges(Boat** boats, int boatCount) {
-   for (int i = 0; i < boatCount; i++) {
-     Boat* boat = boats[i];
-     float monthlyCharge = 0.0;
-     
-     /* Calculate monthly charge based on location type */
-     switch (boat->locationType) {
-       case SLIP:
-         monthlyCharge = boat->length * SLIP_RATE;
-         break;
-       case LAND:
-         monthlyCharge = boat->length * LAND_RATE;
-         break;
-       case TRAILOR:
-         monthlyCharge = boat->length * TRAILOR_RATE;
-         break;
-       case STORAGE:
-         monthlyCharge = boat->length * STORAGE_RATE;
-         break;
+ /*
+  * Merge the sorted runs boats[0..middle) and boats[middle..count) in place, keeping equal
+  * boats in order: split the longer run in half, find where its middle boat belongs in the
+  * other run, rotate the two pieces in between past each other, then merge each side.
+  */
+ void mergeBoatsInPlace(Boat** boats, int middle, int count) {
+   if (middle == 0 || middle == count) {
+     return;
+   }
+   if (count == 2) {
+     if (compareBoatKeys(boats[1], boats[0]) < 0) {
+       Boat* swap = boats[0];
+       boats[0] = boats[1];
+       boats[1] = swap;
      }
-     
-     /* Update amount owed */
-     boat->amountOwed += monthlyCharge;
+     return;
    }
    
-   printf("\n");
+   int leftCut;
+   int rightCut;
+   if (middle > count - middle) {
+     /* Right run: the first boat not before the left run's middle boat */
+     leftCut = middle / 2;
+     int low = middle;
+     int high = count;
+     while (low < high) {
+       int probe = low + (high - low) / 2;
+       if (compareBoatKeys(boats[probe], boats[leftCut]) < 0) {
+         low = probe + 1;
+       } else {
+         high = probe;
+       }
+     }
+     rightCut = low;
+   } else {
+     /* Left run: the first boat after the right run's middle boat */
+     rightCut = middle + (count - middle) / 2;
+     int low = 0;
+     int high = middle;
+     while (low < high) {
+       int probe = low + (high - low) / 2;
+       if (compareBoatKeys(boats[rightCut], boats[probe]) < 0) {
+         high = probe;
+       } else {
+         low = probe + 1;
+       }
+     }
+     leftCut = low;
+   }
+   
+   /* Rotate boats[leftCut..middle) past boats[middle..rightCut) by three reversals */
+   reverseBoats(boats + leftCut, middle - leftCut);
+   reverseBoats(boats + middle, rightCut - middle);
+   reverseBoats(boats + leftCut, rightCut - leftCut);
+   
+   int newMiddle = leftCut + (rightCut - middle);
+   mergeBoatsInPlace(boats, leftCut, newMiddle);
+   mergeBoatsInPlace(boats + newMiddle, rightCut - newMiddle, count - newMiddle);
  }
  
- /* Convert location type to string */
- char* locationTypeToString(LocationType type) {
-   switch (type) {
-     case SLIP:
-       return "slip";
-     case LAND:
-       return "land";
-     case TRAILOR:
-       return "trailor";
-     case STORAGE:
-       return "storage";
-     default:
-       return "unknown";
+ /* Reverse the order of count boat pointers */
+ void reverseBoats(Boat** boats, int count) {
+   for (int i = 0, j = count - 1; i < j; i++, j--) {
+     Boat* swap = boats[i];
+     boats[i] = boats[j];
+     boats[j] = swap;
    }
  }
  
- /* Find a boat by name (case insensitive) */
- int findBoatByName(Boat** boats, int boatCount, const char* name) {
-   for (int i = 0; i < boatCount; i++) {
-     if (strcasecmp(boats[i]->name, name) == 0) {
-       return i;
+ /* Merge two sorted neighbouring runs of source into target, taking from the left run on ties */
+ void mergeBoatRuns(Boat** source, Boat** target, int begin, int middle, int end) {
+   int left = begin;
+   int right = middle;
+   int out = begin;
+   
+   while (left < middle && right < end) {
+     if (compareBoatKeys(source[right], source[left]) < 0) {
+       target[out++] = source[right++];
+     } else {
+       target[out++] = source[left++];
      }
    }
+   memcpy(target + out, source + left, (size_t)(middle - left) * sizeof(Boat*));
+   out += middle - left;
+   memcpy(target + out, source + right, (size_t)(end - right) * sizeof(Boat*));
+ }
+ 
+ /* Sorting thread: sort one run in place, using the matching range of the scratch array */
+ void* sortBoatRun(void* argument) {
+   SortTask* task = (SortTask*)argument;
+   
+   mergeSortBoats(task->source + task->begin, task->target + task->begin, task->end - task->begin);
+   return NULL;
+ }
+ 
+ /* Sorting thread: merge one pair of neighbouring runs */
+ void* mergeBoatRunPair(void* argument) {
+   SortTask* task = (SortTask*)argument;
+   
+   mergeBoatRuns(task->source, task->target, task->begin, task->middle, task->end);
+   return NULL;
+ }
+ 
+ /* Continue a 64-bit FNV-1a hash over a block of bytes */
+ uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+   const unsigned char* bytes = (const unsigned char*)data;
+   
+   for (size_t i = 0; i < size; i++) {
+     hash ^= bytes[i];
+     hash *= 1099511628211ull;
+   }
    
-   return -1; /* Boat not found */
+   return hash;
  }
  
- /* Free all allocated memory */
- void freeAllBoats(Boat** boats, int boatCount) {
-   for (int i = 0; i < boatCount; i++) {
-     free(boats[i]);
+ /* Checksum contribution of one snapshot record, tied to its position */
+ uint64_t hashSnapshotRecord(uint32_t index, const void* record, size_t size) {
+   return hashBytes(record, size, hashBytes(&index, sizeof(index), 14695981039346656037ull));
+ }
+ 
+ /* Check that data starts with a snapshot header whose version and sizes match the data */
+ int isSnapshotHeader(const char* data, size_t size) {
+   SnapshotHeader header;
+   
+   if (!readSnapshotHeader(data, size, &header) || memcmp(header.magic, SNAPSHOT_MAGIC, 4) != 0 ||
+       header.version != SNAPSHOT_VERSION) {
+     return 0;
+   }
+   size_t recordsSize = size - sizeof(SnapshotHeader);
+   
+   return recordsSize / sizeof(SnapshotRecord) >= header.recordCount &&
+          recordsSize - (size_t)header.recordCount * sizeof(SnapshotRecord) == header.stringTableSize;
+ }
+ 
+ /* Copy out the header at the start of data (returns 0 if too short) */
+ int readSnapshotHeader(const char* data, size_t size, SnapshotHeader* header) {
+   if (size < sizeof(*header)) {
+     return 0;
+   }
+   memcpy(header, data, sizeof(*header));
+   return 1;
+ }
+ 
+ /* Generation of the snapshot in a file (0 if it is not a snapshot) */
+ uint64_t readSnapshotGeneration(const char* filename) {
+   SnapshotHeader header;
+   char data[sizeof(SnapshotHeader)];
+   int fd = open(filename, O_RDONLY);
+   
+   if (fd == -1) {
+     return 0;
+   }
+   ssize_t length = pread(fd, data, sizeof(data), 0);
+   close(fd);
+   
+   if (length <= 0 || !readSnapshotHeader(data, (size_t)length, &header) ||
+       memcmp(header.magic, SNAPSHOT_MAGIC, 4) != 0) {
+     return 0;
    }
- }
\ No newline at end of file
+   return header.generation;
+ }
+ 
+ /* Load boats from a binary snapshot (returns 0 if the snapshot is damaged) */
+ int loadSnapshot(const char* data, size_t size, BoatStore* store) {
+   SnapshotHeader header;
+   
+   if (!isSnapshotHeader(data, size)) {
+     return 0;
+   }
+   readSnapshotHeader(data, size, &header);
+   
+   const char* records = data + sizeof(SnapshotHeader);
+   const char* strings = records + (size_t)header.recordCount * sizeof(SnapshotRecord);
+   
+   /* Verify the checksum, and that the names follow each other without gaps or overlaps */
+   uint64_t checksum = hashBytes(strings, header.stringTableSize, 14695981039346656037ull);
+   size_t stringsEnd = 0;
+   for (uint32_t i = 0; i < header.recordCount; i++) {
+     SnapshotRecord record;
+     memcpy(&record, records + (size_t)i * sizeof(record), sizeof(record));
+     if (record.nameOffset != stringsEnd || record.nameOffset >= header.stringTableSize ||
+         record.length > MAX_BOAT_LENGTH || record.locationType > STORAGE ||
+         (record.locationType == LAND && record.location > UCHAR_MAX)) {
+       return 0;
+     }
+     
+     const char* name = strings + record.nameOffset;
+     size_t left = header.stringTableSize - record.nameOffset;
+     const char* nameEnd = memchr(name, '\0', left < MAX_NAME_LENGTH ? left : MAX_NAME_LENGTH);
+     if (nameEnd == NULL) {
+       return 0;
+     }
+     stringsEnd = (size_t)(nameEnd + 1 - strings);
+     if (record.locationType == TRAILOR) {
+       left -= (size_t)(nameEnd + 1 - name);
+       const char* tagEnd = memchr(nameEnd + 1, '\0', left < MAX_TAG_LENGTH + 1 ? left : MAX_TAG_LENGTH + 1);
+       if (tagEnd == NULL) {
+         return 0;
+       }
+       stringsEnd = (size_t)(tagEnd + 1 - strings);
+     }
+     checksum += hashSnapshotRecord(i, &record, sizeof(record));
+   }
+   if (stringsEnd != header.stringTableSize || checksum != header.checksum) {
+     return 0;
+   }
+   
+   /* Size the store and name index once; an empty index grows without rehashing anything */
+   if (!reserveBoats(store, (int)header.recordCount) || !reserveNameIndex(&store->index, (int)header.recordCount)) {
+     printf("Error: Memory allocation failed.\n");
+     return 1;
+   }
+   
+   /* Records are already in name order, so no sorting is needed */
+   for (uint32_t i = 0; i < header.recordCount; i++) {
+     SnapshotRecord record;
+     memcpy(&record, records + (size_t)i * sizeof(record), sizeof(record));
+     
+     Boat* newBoat = allocateBoat(&store->pool);
+     if (newBoat == NULL) {
+       printf("Error: Memory allocation failed.\n");
+       break;
+     }
+     
+     /* The checks above guarantee both strings are NUL-terminated */
+     const char* name = strings + record.nameOffset;
+     size_t nameLength = strlen(name);
+     const char* tag = record.locationType == TRAILOR ? name + nameLength + 1 : NULL;
+     newBoat->name = internName(&store->names, name, nameLength, tag, tag != NULL ? strlen(tag) : 0);
+     if (newBoat->name == NULL) {
+       releaseBoat(&store->pool, newBoat);
+       printf("Error: Memory allocation failed.\n");
+       break;
+     }
+     newBoat->length = record.length;
+     newBoat->locationType = record.locationType;
+     newBoat->location = record.location;
+     
+     if (!storeLoadedBoat(store, newBoat, record.centsOwed)) {
+       printf("Error: Memory allocation failed.\n");
+       break;
+     }
+   }
+   
+   return 1;
+ }
+ 
+ /* Load boat data from a CSV file or binary snapshot (returns 1 if the data was a snapshot, -1 if damaged) */
+ int loadBoatData(const char* filename, BoatStore* store) {
+   int snapshot = isSnapshotPath(filename);
+   
+   /* Finish an in-place snapshot update interrupted by a crash */
+   applySnapshotPatch(filename);
+   
+   int fd = open(filename, O_RDONLY);
+   size_t size;
+   int mapped;
+   
+   /* Check if file opened successfully */
+   if (fd == -1) {
+     printf("Warning: Could not open file %s for reading.\n", filename);
+     replayJournal(store);
+     return snapshot;
+   }
+   
+   /* Map the file so it is parsed in place instead of copied out piece by piece */
+   const char* data = mapFile(fd, &size, &mapped);
+   close(fd);
+   if (data == NULL) {
+     printf("Error: Memory allocation failed.\n");
+   } 
+   else if (isSnapshotHeader(data, size) || (snapshot && size >= 4 && memcmp(data, SNAPSHOT_MAGIC, 4) == 0)) {
+     /* A CSV file may start with the magic too (a boat named "BMS1..."), so it takes a whole header */
+     snapshot = 1;
+     if (!loadSnapshot(data, size, store)) {
+       printf("Error: Snapshot file %s is damaged.\n", filename);
+       unmapFile(data, size, mapped);
+       return -1;
+     }
+   } 
+   else {
+     snapshot = 0;
+     loadCsvData(data, size, store);
+   }
+   unmapFile(data, size, mapped);
+   
+   /* Apply the changes made since the file was last saved */
+   replayJournal(store);
+   reportDoubleBookings(store);
+   return snapshot;
+ }
+ 
+ /* Check whether a file name calls for the binary snapshot format */
+ int isSnapshotPath(const char* filename) {
+   size_t length = strlen(filename);
+   size_t extensionLength = strlen(SNAPSHOT_EXTENSION);
+   
+   return length >= extensionLength && strcmp(filename + length - extensionLength, SNAPSHOT_EXTENSION) == 0;
+ }
+ 
+ /* Save boat data in the format given by the file name (returns 0 on failure) */
+ int saveBoatData(const char* filename, BoatStore* store) {
+   if (isSnapshotPath(filename)) {
+     return saveSnapshot(filename, store);
+   }
+   
+   return saveCsvData(filename, store);
+ }
+ 
+ /* Save boat data to CSV file (returns 0 on failure) */
+ int saveCsvData(const char* filename, BoatStore* store) {
+   char* tempPath;
+   FILE* file = createTempFile(filename, &tempPath);
+   
+   /* Check if file opened successfully */
+   if (file == NULL) {
+     printf("Error: Could not open file %s for writing.\n", filename);
+     return 0;
+   }
+   
+   /* Write each boat to file, one formatted line per boat */
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     char location[16];
+     char amount[32];
+     
+     /* Format location-specific information */
+     switch (boatLocationType(boat)) {
+       case SLIP:
+         snprintf(location, sizeof(location), "%d", boatSlipNumber(boat));
+         break;
+       case LAND:
+         snprintf(location, sizeof(location), "%c", boatBayLetter(boat));
+         break;
+       case TRAILOR:
+         snprintf(location, sizeof(location), "%s", boatTrailorTag(boat));
+         break;
+       case STORAGE:
+         snprintf(location, sizeof(location), "%d", boatStorageSpace(boat));
+         break;
+     }
+     
+     formatCents(amount, sizeof(amount), store->hot.centsOwed[boat->slot]);
+     fprintf(file, "%s,%d,%s,%s,%s\n", 
+             boat->name, 
+             boatLength(boat),
+             locationTypeToString(boatLocationType(boat)),
+             location,
+             amount);
+   }
+   
+   return replaceWithTempFile(file, tempPath, filename);
+ }
+ 
+ /* Rewrite only the records of boats whose balance changed, through a redo log (returns 0 on failure) */
+ int saveSnapshotChanges(const char* filename, BoatStore* store) {
+   SnapshotPatchHeader patch;
+   SnapshotRecord oldRecord;
+   int fd = open(filename, O_RDONLY);
+   
+   if (fd == -1) {
+     return 0;
+   }
+   
+   /* The snapshot must still hold exactly the boats in the store, in the same order */
+   memcpy(patch.magic, SNAPSHOT_PATCH_MAGIC, sizeof(patch.magic));
+   patch.recordCount = (uint32_t)store->dirtyCount;
+   if (pread(fd, &patch.snapshotHeader, sizeof(patch.snapshotHeader), 0) != (ssize_t)sizeof(patch.snapshotHeader) ||
+       memcmp(patch.snapshotHeader.magic, SNAPSHOT_MAGIC, sizeof(patch.snapshotHeader.magic)) != 0 ||
+       patch.snapshotHeader.version != SNAPSHOT_VERSION ||
+       patch.snapshotHeader.recordCount != (uint32_t)store->count) {
+     close(fd);
+     return 0;
+   }
+   
+   SnapshotPatchEntry* entries = (SnapshotPatchEntry*)malloc((size_t)(store->dirtyCount + 1) * sizeof(SnapshotPatchEntry));
+   if (entries == NULL) {
+     close(fd);
+     return 0;
+   }
+   
+   /* Update each changed record and adjust the additive checksum by the difference */
+   for (int i = 0; i < store->dirtyCount; i++) {
+     Boat* boat = store->dirtyBoats[i];
+     int index = indexOfBoat(store, boat);
+     off_t offset = (off_t)(sizeof(SnapshotHeader) + (size_t)index * sizeof(SnapshotRecord));
+     
+     if (pread(fd, &oldRecord, sizeof(oldRecord), offset) != (ssize_t)sizeof(oldRecord) ||
+         oldRecord.length != boat->length || oldRecord.locationType != boat->locationType ||
+         oldRecord.location != boat->location) {
+       free(entries);
+       close(fd);
+       return 0;
+     }
+     
+     entries[i].index = (uint64_t)index;
+     entries[i].record = oldRecord;
+     entries[i].record.centsOwed = store->hot.centsOwed[boat->slot];
+     patch.snapshotHeader.checksum += hashSnapshotRecord((uint32_t)index, &entries[i].record, sizeof(SnapshotRecord)) -
+                                      hashSnapshotRecord((uint32_t)index, &oldRecord, sizeof(oldRecord));
+   }
+   close(fd);
+   patch.snapshotHeader.generation++; /* The file keeps its inode and size, so mark the update */
+   
+   patch.checksum = hashBytes(entries, (size_t)store->dirtyCount * sizeof(SnapshotPatchEntry),
+                              hashBytes(&patch.snapshotHeader, sizeof(patch.snapshotHeader), 14695981039346656037ull));
+   
+   /* Make the redo log durable first, then apply it */
+   char* patchPath = (char*)malloc(strlen(filename) + sizeof(".patch"));
+   char* tempPath;
+   FILE* file = NULL;
+   if (patchPath != NULL) {
+     strcpy(patchPath, filename);
+     strcat(patchPath, ".patch");
+     file = createTempFile(patchPath, &tempPath);
+   }
+   if (file == NULL) {
+     free(patchPath);
+     free(entries);
+     return 0;
+   }
+   fwrite(&patch, sizeof(patch), 1, file);
+   fwrite(entries, sizeof(SnapshotPatchEntry), (size_t)store->dirtyCount, file);
+   free(entries);
+   
+   int saved = replaceWithTempFile(file, tempPath, patchPath) && applySnapshotPatch(filename);
+   free(patchPath);
+   return saved;
+ }
+ 
+ /* Apply a pending snapshot redo log, if there is one (returns 0 on failure) */
+ int applySnapshotPatch(const char* filename) {
+   SnapshotPatchHeader patch;
+   SnapshotHeader current;
+   size_t size;
+   int mapped;
+   int applied = 1;
+   
+   char* patchPath = (char*)malloc(strlen(filename) + sizeof(".patch"));
+   if (patchPath == NULL) {
+     return 0;
+   }
+   strcpy(patchPath, filename);
+   strcat(patchPath, ".patch");
+   
+   int patchFd = open(patchPath, O_RDONLY);
+   if (patchFd == -1) {
+     free(patchPath);
+     return 1; /* Nothing pending */
+   }
+   const char* data = mapFile(patchFd, &size, &mapped);
+   close(patchFd);
+   
+   /* Redo logs are renamed into place complete, but check them anyway */
+   if (data == NULL || size < sizeof(patch)) {
+     applied = 0;
+   } else {
+     memcpy(&patch, data, sizeof(patch));
+     const SnapshotPatchEntry* entries = (const SnapshotPatchEntry*)(data + sizeof(patch));
+     if (memcmp(patch.magic, SNAPSHOT_PATCH_MAGIC, sizeof(patch.magic)) != 0 ||
+         size != sizeof(patch) + (size_t)patch.recordCount * sizeof(SnapshotPatchEntry) ||
+         patch.checksum != hashBytes(entries, (size_t)patch.recordCount * sizeof(SnapshotPatchEntry),
+                                     hashBytes(&patch.snapshotHeader, sizeof(patch.snapshotHeader),
+                                               14695981039346656037ull))) {
+       applied = 0;
+     } else {
+       int fd = open(filename, O_RDWR);
+       if (fd == -1 || pread(fd, &current, sizeof(current), 0) != (ssize_t)sizeof(current)) {
+         applied = 0;
+       } else if (memcmp(&current, &patch.snapshotHeader, sizeof(current)) != 0) {
+         /* Records first, header last: a header that already matches means the log was applied */
+         for (uint32_t i = 0; i < patch.recordCount && applied; i++) {
+           off_t offset = (off_t)(sizeof(SnapshotHeader) + entries[i].index * sizeof(SnapshotRecord));
+           applied = pwrite(fd, &entries[i].record, sizeof(SnapshotRecord), offset) == (ssize_t)sizeof(SnapshotRecord);
+         }
+         applied = applied && fsync(fd) == 0 &&
+                   pwrite(fd, &patch.snapshotHeader, sizeof(patch.snapshotHeader), 0) == (ssize_t)sizeof(patch.snapshotHeader) &&
+                   fsync(fd) == 0;
+       }
+       if (fd != -1) {
+         close(fd);
+       }
+     }
+   }
+   
+   if (data != NULL) {
+     unmapFile(data, size, mapped);
+   }
+   if (applied) {
+     unlink(patchPath);
+   } else {
+     printf("Error: Could not apply update %s to %s.\n", patchPath, filename);
+   }
+   free(patchPath);
+   return applied;
+ }
+ 
+ /* Bring the data file up to date, rewriting only what changed where the format allows it */
+ int saveChanges(BoatStore* store) {
+   const char* filename = store->journal.dataPath;
+   
+   if (!store->allDirty && store->dirtyCount == 0) {
+     return 1; /* The file already matches */
+   }
+   
+   /* CSV lines vary in width, so only snapshots can be updated in place */
+   if (!(isSnapshotPath(filename) && !store->allDirty && saveSnapshotChanges(filename, store)) &&
+       !saveBoatData(filename, store)) {
+     return 0;
+   }
+   
+   clearDirtyBoats(store);
+   return 1;
+ }
+ 
+ /* Remember that a boat's balance changed since the data file was saved */
+ void markBoatDirty(BoatStore* store, Boat* boat) {
+   if (store->allDirty || store->hot.dirty[boat->slot]) {
+     return;
+   }
+   
+   if (store->dirtyCount == store->dirtyCapacity) {
+     int capacity = store->dirtyCapacity == 0 ? INITIAL_STORE_CAPACITY : store->dirtyCapacity * 2;
+     Boat** grown = (Boat**)realloc(store->dirtyBoats, (size_t)capacity * sizeof(Boat*));
+     if (grown == NULL) {
+       markAllDirty(store); /* Fall back to a full save */
+       return;
+     }
+     store->dirtyBoats = grown;
+     store->dirtyCapacity = capacity;
+   }
+   
+   store->hot.dirty[boat->slot] = 1;
+   store->dirtyBoats[store->dirtyCount++] = boat;
+ }
+ 
+ /* Remember that the whole file must be rewritten; the dirty list is no longer needed */
+ void markAllDirty(BoatStore* store) {
+   clearDirtyBoats(store);
+   store->allDirty = 1;
+ }
+ 
+ /* Forget all changes after the data file was saved */
+ void clearDirtyBoats(BoatStore* store) {
+   for (int i = 0; i < store->dirtyCount; i++) {
+     store->hot.dirty[store->dirtyBoats[i]->slot] = 0;
+   }
+   
+   store->dirtyCount = 0;
+   store->allDirty = 0;
+ }
+ 
+ /* Create a buffered temporary file next to the given one (returns NULL on failure) */
+ FILE* createTempFile(const char* filename, char** tempPath) {
+   struct stat st;
+   
+   *tempPath = (char*)malloc(strlen(filename) + sizeof(".XXXXXX"));
+   if (*tempPath == NULL) {
+     return NULL;
+   }
+   strcpy(*tempPath, filename);
+   strcat(*tempPath, ".XXXXXX");
+   
+   int fd = mkstemp(*tempPath);
+   if (fd == -1) {
+     free(*tempPath);
+     return NULL;
+   }
+   
+   /* Keep the permissions of the file being replaced (mkstemp creates it private) */
+   if (stat(filename, &st) == 0) {
+     fchmod(fd, st.st_mode & 07777);
+   } else {
+     mode_t mask = umask(0);
+     umask(mask);
+     fchmod(fd, 0666 & ~mask);
+   }
+   
+   FILE* file = fdopen(fd, "w");
+   if (file == NULL) {
+     close(fd);
+     unlink(*tempPath);
+     free(*tempPath);
+     return NULL;
+   }
+   
+   /* Write in large blocks */
+   setvbuf(file, NULL, _IOFBF, SAVE_BUFFER_SIZE);
+   return file;
+ }
+ 
+ /*
+  * Finish a temporary file from createTempFile() and atomically rename it over the given
+  * file, so a crash or full disk leaves either the old or the new contents, never a mix.
+  * Returns 0 on failure, in which case the original file is untouched.
+  */
+ int replaceWithTempFile(FILE* file, char* tempPath, const char* filename) {
+   /* Flush to disk before the rename makes the new contents visible */
+   int written = !ferror(file) && fflush(file) == 0 && fsync(fileno(file)) == 0;
+   
+   /* Close file */
+   if (fclose(file) != 0 || !written || rename(tempPath, filename) != 0) {
+     printf("Error: Could not write file %s.\n", filename);
+     unlink(tempPath);
+     free(tempPath);
+     return 0;
+   }
+   free(tempPath);
+   
+   /* Make the rename itself durable by syncing the directory */
+   const char* slash = strrchr(filename, '/');
+   char* directory = slash == NULL ? strdup(".") : strndup(filename, slash == filename ? 1 : (size_t)(slash - filename));
+   if (directory != NULL) {
+     int fd = open(directory, O_RDONLY);
+     if (fd != -1) {
+       fsync(fd);
+       close(fd);
+     }
+     free(directory);
+   }
+   
+   return 1;
+ }
+ 
+ /* Save boat data as a binary snapshot (returns 0 on failure) */
+ int saveSnapshot(const char* filename, BoatStore* store) {
+   SnapshotHeader header;
+   char* tempPath;
+   FILE* file = createTempFile(filename, &tempPath);
+   
+   /* Check if file opened successfully */
+   if (file == NULL) {
+     printf("Error: Could not open file %s for writing.\n", filename);
+     return 0;
+   }
+   
+   memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+   header.version = SNAPSHOT_VERSION;
+   header.recordCount = (uint32_t)store->count;
+   header.stringTableSize = 0;
+   header.checksum = 0;
+   header.generation = readSnapshotGeneration(filename) + 1;
+   fwrite(&header, sizeof(header), 1, file);
+   
+   /* Write the records, laying the name entries out in the same order */
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     SnapshotRecord record;
+     
+     record.centsOwed = store->hot.centsOwed[boat->slot];
+     record.nameOffset = header.stringTableSize;
+     record.length = boat->length;
+     record.locationType = boat->locationType;
+     record.location = boat->location;
+     
+     fwrite(&record, sizeof(record), 1, file);
+     header.checksum += hashSnapshotRecord((uint32_t)i, &record, sizeof(record));
+     header.stringTableSize += (uint32_t)snapshotStringsSize(boat);
+   }
+   
+   /* Write the string table; a trailor tag already follows its name's NUL in the arena */
+   uint64_t stringHash = 14695981039346656037ull;
+   for (int i = 0; i < store->count; i++) {
+     size_t stringsSize = snapshotStringsSize(store->boats[i]);
+     fwrite(store->boats[i]->name, 1, stringsSize, file);
+     stringHash = hashBytes(store->boats[i]->name, stringsSize, stringHash);
+   }
+   header.checksum += stringHash;
+   
+   /* Fill in the header now that the totals are known */
+   fseek(file, 0, SEEK_SET);
+   fwrite(&header, sizeof(header), 1, file);
+   
+   return replaceWithTempFile(file, tempPath, filename);
+ }
+ 
+ /* Bytes a boat takes in the snapshot string table: its name and any trailor tag, each with its NUL */
+ size_t snapshotStringsSize(const Boat* boat) {
+   size_t size = strlen(boat->name) + 1;
+   
+   if (boatLocationType(boat) == TRAILOR) {
+     size += strlen(boatTrailorTag(boat)) + 1;
+   }
+   return size;
+ }
+ 
+ /* Prepare a journal for the given data file (returns 0 on failure) */
+ int initJournal(Journal* journal, const char* dataPath) {
+   journal->fd = -1;
+   journal->dataPath = dataPath;
+   journal->pending = NULL;
+   journal->pendingLength = 0;
+   journal->pendingCapacity = 0;
+   journal->size = -1;
+   journal->dataSize = 0;
+   
+   journal->path = (char*)malloc(strlen(dataPath) + sizeof(".journal"));
+   if (journal->path == NULL) {
+     return 0;
+   }
+   strcpy(journal->path, dataPath);
+   strcat(journal->path, ".journal");
+   return 1;
+ }
+ 
+ /*
+  * Build the journal header line identifying the current version of the data file.
+  * Saving the data file changes its inode, size or snapshot generation (an in-place snapshot
+  * update keeps inode and size, and its modification time may not tick over), so a journal
+  * left behind by a crash after the save (whose changes are already in the file) no longer matches.
+  */
+ void fingerprintFile(const char* path, char* header, size_t headerSize, long long* size) {
+   struct stat st;
+   
+   if (stat(path, &st) != 0) {
+     memset(&st, 0, sizeof(st));
+   }
+   
+   *size = (long long)st.st_size;
+   int length = snprintf(header, headerSize, "BMJ1 %llu %lld %lld %ld",
+                         (unsigned long long)st.st_ino, (long long)st.st_size,
+                         (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+   
+   /* CSV files have no generation and always show 0 */
+   snprintf(header + length, headerSize - (size_t)length, " %llu\n", (unsigned long long)readSnapshotGeneration(path));
+ }
+ 
+ /* Replay the journal of changes made since the data file was last saved */
+ void replayJournal(BoatStore* store) {
+   Journal* journal = &store->journal;
+   FILE* file = fopen(journal->path, "r");
+   char expected[128];
+   char* line = NULL;
+   size_t lineCapacity = 0;
+   ssize_t length;
+   
+   if (file == NULL) {
+     return; /* No journal */
+   }
+   
+   /* Only a journal started from this exact data file applies to it */
+   fingerprintFile(journal->dataPath, expected, sizeof(expected), &journal->dataSize);
+   length = getline(&line, &lineCapacity, file);
+   if (length <= 0 || strcmp(line, expected) != 0) {
+     printf("Warning: Ignoring journal %s; it does not match %s.\n", journal->path, journal->dataPath);
+   } else {
+     journal->size = length;
+     
+     /* A final line without a newline was cut short by a crash and is dropped */
+     while ((length = getline(&line, &lineCapacity, file)) > 0 && line[length - 1] == '\n') {
+       executeCommand(store, line);
+       journal->size += length;
+     }
+   }
+   
+   free(line);
+   fclose(file);
+ }
+ 
+ /* Open the journal for appending, starting a fresh one if there is no valid journal */
+ void openJournal(Journal* journal) {
+   char header[128];
+   
+   fingerprintFile(journal->dataPath, header, sizeof(header), &journal->dataSize);
+   
+   if (journal->size >= 0) {
+     /* Keep the replayed records, dropping any torn tail */
+     journal->fd = open(journal->path, O_WRONLY | O_APPEND);
+     if (journal->fd != -1 && ftruncate(journal->fd, (off_t)journal->size) != 0) {
+       close(journal->fd);
+       journal->fd = -1;
+     }
+   } else {
+     journal->fd = open(journal->path, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC, 0644);
+     journal->size = (long long)strlen(header);
+     if (journal->fd != -1 &&
+         (write(journal->fd, header, strlen(header)) != (ssize_t)strlen(header) || fdatasync(journal->fd) != 0)) {
+       close(journal->fd);
+       journal->fd = -1;
+     }
+   }
+   
+   /* Without a journal the data file is simply saved on exit */
+   if (journal->fd == -1) {
+     printf("Warning: Could not open journal %s; changes are saved on exit only.\n", journal->path);
+   }
+ }
+ 
+ /* Queue a journal record; records reach the disk at the next commitJournal() */
+ void journalAppend(Journal* journal, const char* format, ...) {
+   va_list args;
+   
+   if (journal->fd == -1) {
+     return;
+   }
+   
+   va_start(args, format);
+   int length = vsnprintf(NULL, 0, format, args);
+   va_end(args);
+   
+   if (journal->pendingLength + (size_t)length + 1 > journal->pendingCapacity) {
+     size_t capacity = journal->pendingCapacity == 0 ? 4096 : journal->pendingCapacity;
+     while (journal->pendingLength + (size_t)length + 1 > capacity) {
+       capacity *= 2;
+     }
+     char* grown = (char*)realloc(journal->pending, capacity);
+     if (grown == NULL) {
+       printf("Error: Memory allocation failed.\n");
+       return;
+     }
+     journal->pending = grown;
+     journal->pendingCapacity = capacity;
+   }
+   
+   va_start(args, format);
+   vsnprintf(journal->pending + journal->pendingLength, (size_t)length + 1, format, args);
+   va_end(args);
+   journal->pendingLength += (size_t)length;
+ }
+ 
+ /* Write queued records to the journal with one write and one fdatasync, compacting when due */
+ void commitJournal(BoatStore* store) {
+   Journal* journal = &store->journal;
+   
+   if (journal->fd == -1 || journal->pendingLength == 0) {
+     return;
+   }
+   
+   if (write(journal->fd, journal->pending, journal->pendingLength) != (ssize_t)journal->pendingLength ||
+       fdatasync(journal->fd) != 0) {
+     /* Fall back to saving the whole file on exit */
+     printf("Error: Could not write journal %s.\n", journal->path);
+     close(journal->fd);
+     journal->fd = -1;
+     return;
+   }
+   journal->size += (long long)journal->pendingLength;
+   journal->pendingLength = 0;
+   
+   /* Rewriting the data file once the journal reaches half its size keeps the cost amortised O(1) */
+   if (journal->size > journal->dataSize / 2) {
+     compactJournal(store);
+   }
+ }
+ 
+ /* Fold the journal into the data file and start an empty journal */
+ void compactJournal(BoatStore* store) {
+   Journal* journal = &store->journal;
+   char header[128];
+   
+   if (!saveChanges(store)) {
+     return; /* Keep journaling; the old data file plus the journal is still complete */
+   }
+   if (journal->fd == -1) {
+     return;
+   }
+   
+   fingerprintFile(journal->dataPath, header, sizeof(header), &journal->dataSize);
+   journal->size = (long long)strlen(header);
+   if (ftruncate(journal->fd, 0) != 0 ||
+       write(journal->fd, header, strlen(header)) != (ssize_t)strlen(header) ||
+       fdatasync(journal->fd) != 0) {
+     /* A stale journal no longer matches the saved file, so it is ignored on the next start */
+     printf("Error: Could not write journal %s.\n", journal->path);
+     close(journal->fd);
+     journal->fd = -1;
+   }
+ }
+ 
+ /* Flush the journal on exit, removing it when it holds no changes */
+ void closeJournal(BoatStore* store) {
+   Journal* journal = &store->journal;
+   char header[128];
+   long long dataSize;
+   
+   commitJournal(store);
+   
+   if (journal->fd != -1 && journal->dataSize <= JOURNAL_EXIT_SAVE_BYTES) {
+     fingerprintFile(journal->dataPath, header, sizeof(header), &dataSize);
+     if (journal->size > (long long)strlen(header)) {
+       compactJournal(store);
+     }
+   }
+   
+   if (journal->fd == -1) {
+     saveChanges(store);
+   } else {
+     close(journal->fd);
+     fingerprintFile(journal->dataPath, header, sizeof(header), &dataSize);
+     if (journal->size == (long long)strlen(header)) {
+       unlink(journal->path);
+     }
+   }
+   
+   free(journal->pending);
+   free(journal->path);
+   journal->fd = -1;
+ }
+ 
+ /* Compare boats by name (for qsort, which the benchmarks measure sortBoats() against) */
+ int compareBoats(const void* a, const void* b) {
+   Boat* boatA = *(Boat**)a;
+   Boat* boatB = *(Boat**)b;
+   
+   return compareBoatKeys(boatA, boatB);
+ }
+ 
+ /* Build the sort key of a name, so most comparisons need only one integer compare */
+ uint64_t foldNameKey(const char* name) {
+   uint64_t key = 0;
+   
+   for (int i = 0; i < 8 && name[i] != '\0'; i++) {
+     key |= (uint64_t)(unsigned char)tolower((unsigned char)name[i]) << (56 - 8 * i);
+   }
+   
+   return key;
+ }
+ 
+ /* Compare two names with their sort keys, ordering them like strcasecmp */
+ int compareNameKeys(uint64_t keyA, const char* nameA, uint64_t keyB, const char* nameB) {
+   if (keyA != keyB) {
+     return keyA < keyB ? -1 : 1;
+   }
+   
+   /* Equal keys that end in a zero byte belong to equal names shorter than 8 characters */
+   if ((keyA & 0xff) == 0) {
+     return 0;
+   }
+   
+   return strcasecmp(nameA + 8, nameB + 8);
+ }
+ 
+ /* Compare boats by name through their sort keys */
+ int compareBoatKeys(const Boat* boatA, const Boat* boatB) {
+   return compareNameKeys(boatSortKey(boatA), boatA->name, boatSortKey(boatB), boatB->name);
+ }
+ 
+ /* Sort key of a boat's name, stored just before the name in the arena */
+ uint64_t boatSortKey(const Boat* boat) {
+   uint64_t key;
+   
+   memcpy(&key, boat->name - sizeof(key), sizeof(key));
+   return key;
+ }
+ 
+ /* Length of a boat in whole feet */
+ int boatLength(const Boat* boat) {
+   return boat->length;
+ }
+ 
+ /* Where a boat is kept */
+ LocationType boatLocationType(const Boat* boat) {
+   return (LocationType)boat->locationType;
+ }
+ 
+ /* Slip number of a boat in a slip */
+ int boatSlipNumber(const Boat* boat) {
+   return boat->location;
+ }
+ 
+ /* Bay letter of a boat on land */
+ char boatBayLetter(const Boat* boat) {
+   return (char)boat->location;
+ }
+ 
+ /* Trailor tag of a boat on a trailor, stored just after the name in the arena */
+ const char* boatTrailorTag(const Boat* boat) {
+   return boat->name + strlen(boat->name) + 1;
+ }
+ 
+ /* Storage space number of a boat in storage */
+ int boatStorageSpace(const Boat* boat) {
+   return boat->location;
+ }
+ 
+ /* Fit a length into a boat record in whole feet (returns 0 unless it is 0 to MAX_BOAT_LENGTH feet) */
+ int packLength(double length, uint8_t* packed) {
+   int32_t feet = wholeFeet((float)length);
+   
+   if (feet < 0 || feet > MAX_BOAT_LENGTH) {
+     return 0;
+   }
+   *packed = (uint8_t)feet;
+   return 1;
+ }
+ 
+ /* Fit a slip or storage space number into a boat record (returns 0 unless it is 0 to MAX_TRACKED_PLACE) */
+ int packPlace(int place, uint16_t* packed) {
+   if (place < 0 || place > MAX_TRACKED_PLACE) {
+     return 0;
+   }
+   *packed = (uint16_t)place;
+   return 1;
+ }
+ 
+ /* Display a run of boats from the sorted store, written out a buffer at a time */
+ void displayBoats(BoatStore* store, int first, int count) {
+   static RenderBuffer buffer = {.fd = STDOUT_FILENO};
+   
+   writeBoats(store, first, count, &buffer);
+ }
+ 
+ /* Render a run of boats into a buffer, writing it out whenever it fills (returns 0 on failure) */
+ int writeBoats(BoatStore* store, int first, int count, RenderBuffer* buffer) {
+   for (int i = first; i < first + count; i++) {
+     if (RENDER_BUFFER_BYTES - buffer->used < MAX_ROW_LENGTH && !flushRenderBuffer(buffer)) {
+       return 0;
+     }
+     buffer->used += cachedBoatRow(store, store->boats[i], buffer->data + buffer->used);
+   }
+   return flushRenderBuffer(buffer);
+ }
+ 
+ /* Format one inventory row into out, at most MAX_ROW_LENGTH bytes, and return its length */
+ size_t renderBoatRow(const BoatStore* store, const Boat* boat, char* out) {
+   char* end = out;
+   
+   /* Same layout as "%-20s %3d' " */
+   end = renderText(end, boat->name, strlen(boat->name), 20, 1);
+   *end++ = ' ';
+   end = renderInteger(end, boatLength(boat), 3);
+   *end++ = '\'';
+   *end++ = ' ';
+   
+   /* Location-specific information */
+   switch (boatLocationType(boat)) {
+     case SLIP:
+       end = renderText(end, "    slip   # ", 13, 0, 0);
+       end = renderInteger(end, boatSlipNumber(boat), 2);
+       break;
+     case LAND:
+       end = renderText(end, "    land      ", 14, 0, 0);
+       *end++ = boatBayLetter(boat);
+       break;
+     case TRAILOR: {
+       const char* tag = boatTrailorTag(boat);
+       end = renderText(end, " trailor ", 9, 0, 0);
+       end = renderText(end, tag, strlen(tag), 6, 0);
+       break;
+     }
+     case STORAGE:
+       end = renderText(end, " storage   # ", 13, 0, 0);
+       end = renderInteger(end, boatStorageSpace(boat), 2);
+       break;
+   }
+   
+   /* Amount owed, as "   Owes $%7.2f\n" */
+   end = renderText(end, "   Owes $", 9, 0, 0);
+   end = renderCents(end, store->hot.centsOwed[boat->slot], 7);
+   *end++ = '\n';
+   return (size_t)(end - out);
+ }
+ 
+ /* Copy text padded with spaces to a width, on the right if leftAlign is set; return the end */
+ char* renderText(char* out, const char* text, size_t length, int width, int leftAlign) {
+   size_t padding = length < (size_t)width ? (size_t)width - length : 0;
+   
+   if (!leftAlign) {
+     memset(out, ' ', padding);
+     out += padding;
+   }
+   memcpy(out, text, length);
+   out += length;
+   if (leftAlign) {
+     memset(out, ' ', padding);
+     out += padding;
+   }
+   return out;
+ }
+ 
+ /* Write an integer right-aligned in a width, like "%*d"; return the end */
+ char* renderInteger(char* out, int64_t value, int width) {
+   char digits[24];
+   char* start = digits + sizeof(digits);
+   uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+   
+   do {
+     *--start = (char)('0' + magnitude % 10);
+     magnitude /= 10;
+   } while (magnitude != 0);
+   if (value < 0) {
+     *--start = '-';
+   }
+   return renderText(out, start, (size_t)(digits + sizeof(digits) - start), width, 0);
+ }
+ 
+ /* Write cents as dollars right-aligned in a width, like "%*.2f"; return the end */
+ char* renderCents(char* out, int64_t cents, int width) {
+   char digits[32];
+   char* start = digits + sizeof(digits);
+   uint64_t magnitude = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+   
+   /* From 10^13 dollars up a double no longer rounds to the exact cent, so keep printf's result */
+   if (magnitude >= MAX_EXACT_CENTS) {
+     int length = snprintf(digits, sizeof(digits), "%*.2f", width, cents / 100.0);
+     return renderText(out, digits, (size_t)length, 0, 0);
+   }
+   
+   *--start = (char)('0' + magnitude % 10);
+   *--start = (char)('0' + magnitude / 10 % 10);
+   *--start = '.';
+   magnitude /= 100;
+   do {
+     *--start = (char)('0' + magnitude % 10);
+     magnitude /= 10;
+   } while (magnitude != 0);
+   if (cents < 0) {
+     *--start = '-';
+   }
+   return renderText(out, start, (size_t)(digits + sizeof(digits) - start), width, 0);
+ }
+ 
+ /* Copy a boat's inventory row into out from the row cache, rendering and caching it if needed */
+ size_t cachedBoatRow(BoatStore* store, const Boat* boat, char* out) {
+   RowCache* cache = &store->rows;
+   
+   if (boat->slot < cache->slots && cache->lengths[boat->slot] != 0) {
+     memcpy(out, cache->text + cache->offsets[boat->slot], cache->lengths[boat->slot]);
+     return cache->lengths[boat->slot];
+   }
+   
+   size_t length = renderBoatRow(store, boat, out);
+   cacheRow(cache, boat->slot, out, length);
+   return length;
+ }
+ 
+ /* Keep a copy of a slot's row; when memory runs short the row is simply not cached */
+ void cacheRow(RowCache* cache, int slot, const char* row, size_t length) {
+   if (slot >= cache->slots) {
+     int slots = cache->slots == 0 ? INITIAL_STORE_CAPACITY : cache->slots;
+     while (slots <= slot) {
+       slots *= 2;
+     }
+     uint32_t* offsets = (uint32_t*)realloc(cache->offsets, (size_t)slots * sizeof(uint32_t));
+     if (offsets != NULL) {
+       cache->offsets = offsets;
+     }
+     uint8_t* lengths = (uint8_t*)realloc(cache->lengths, (size_t)slots);
+     if (lengths != NULL) {
+       cache->lengths = lengths;
+     }
+     if (offsets == NULL || lengths == NULL) {
+       return;
+     }
+     memset(cache->lengths + cache->slots, 0, (size_t)(slots - cache->slots));
+     cache->slots = slots;
+   }
+   
+   if (cache->capacity - cache->used < length) {
+     /* Mostly stale rows: start over rather than grow */
+     if (cache->live * 2 <= cache->used) {
+       invalidateAllRows(cache);
+     }
+     if (cache->capacity - cache->used < length) {
+       size_t capacity = cache->capacity == 0 ? RENDER_BUFFER_BYTES : cache->capacity * 2;
+       char* text = capacity <= UINT32_MAX ? (char*)realloc(cache->text, capacity) : NULL;
+       if (text == NULL) {
+         return;
+       }
+       cache->text = text;
+       cache->capacity = capacity;
+     }
+   }
+   
+   memcpy(cache->text + cache->used, row, length);
+   cache->offsets[slot] = (uint32_t)cache->used;
+   cache->lengths[slot] = (uint8_t)length;
+   cache->used += length;
+   cache->live += length;
+ }
+ 
+ /* Forget a slot's cached row after its boat changed or left */
+ void invalidateRow(RowCache* cache, int slot) {
+   if (slot < cache->slots) {
+     cache->live -= cache->lengths[slot];
+     cache->lengths[slot] = 0;
+   }
+ }
+ 
+ /* Forget every cached row, keeping the memory for the next inventory */
+ void invalidateAllRows(RowCache* cache) {
+   if (cache->slots > 0) {
+     memset(cache->lengths, 0, (size_t)cache->slots);
+   }
+   cache->used = 0;
+   cache->live = 0;
+ }
+ 
+ /* Write out the buffered rows, after anything printf still holds for stdout (returns 0 on failure) */
+ int flushRenderBuffer(RenderBuffer* buffer) {
+   size_t done = 0;
+   
+   if (buffer->fd == STDOUT_FILENO) {
+     fflush(stdout);
+   }
+   while (done < buffer->used) {
+     ssize_t written = write(buffer->fd, buffer->data + done, buffer->used - done);
+     if (written < 0 && errno == EINTR) {
+       continue;
+     }
+     if (written <= 0) {
+       buffer->used = 0;
+       return 0;
+     }
+     done += (size_t)written;
+   }
+   buffer->used = 0;
+   return 1;
+ }
+ 
+ /* Display inventory of boats whose names start with a prefix (all boats for "") */
+ void displayInventory(BoatStore* store, const char* prefix) {
+   int first;
+   int count = findBoatsWithPrefix(store, prefix, &first);
+   
+   displayBoats(store, first, count);
+   printf("\n");
+ }
+ 
+ /* Show a page of the inventory: "" or "+" next, "-" previous, "=<n>" page size, else a name */
+ void pageInventory(BoatStore* store, const char* argument) {
+   PageCursor* page = &store->page;
+   
+   if (argument[0] == '\0' || strcmp(argument, "+") == 0) {
+     page->first = page->next;
+   } 
+   else if (strcmp(argument, "-") == 0) {
+     page->first = page->first > page->size ? page->first - page->size : 0;
+   } 
+   else if (argument[0] == '=') {
+     char* end;
+     long size = strtol(argument + 1, &end, 10);
+     if (end == argument + 1 || *end != '\0' || size < 1 || size > INT_MAX) {
+       printf("Error: Invalid page size.\n\n");
+       return;
+     }
+     page->size = (int)size;
+   } else {
+     page->first = findLowerBound(store, argument);
+   }
+   
+   if (page->first >= store->count) {
+     page->first = store->count;
+     page->next = store->count;
+     printf("No more boats\n\n");
+     return;
+   }
+   
+   int count = store->count - page->first < page->size ? store->count - page->first : page->size;
+   displayBoats(store, page->first, count);
+   page->next = page->first + count;
+   printf("Boats %d-%d of %d\n\n", page->first + 1, page->next, store->count);
+ }
+ 
+ /* Keep a page cursor on the same boats when one is inserted (+1) or removed (-1) at an index */
+ void shiftPageCursor(PageCursor* page, int index, int delta) {
+   if (index < page->first) {
+     page->first += delta;
+   }
+   if (index < page->next) {
+     page->next += delta;
+   }
+ }
+ 
+ /* Write the whole inventory to a file from a forked copy of the process, so the menu stays usable */
+ void streamInventory(BoatStore* store, const char* filename) {
+   reapInventoryWriters(0);
+   
+   /* The child must not inherit buffered output and print it a second time */
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0) {
+     /* _exit() skips stdio, so push out any error message first */
+     int written = writeInventoryFile(store, filename);
+     fflush(stdout);
+     _exit(written ? 0 : 1);
+   }
+   
+   if (pid == -1) {
+     /* No process to spare: write it here and now */
+     if (writeInventoryFile(store, filename)) {
+       printf("Inventory written to %s\n\n", filename);
+     }
+     return;
+   }
+   printf("Writing the inventory to %s\n\n", filename);
+ }
+ 
+ /* Write the whole inventory to a file, replacing it atomically (returns 0 on failure) */
+ int writeInventoryFile(BoatStore* store, const char* filename) {
+   char* tempPath;
+   FILE* file = createTempFile(filename, &tempPath);
+   if (file == NULL) {
+     printf("Error: Could not open file %s for writing.\n", filename);
+     return 0;
+   }
+   
+   RenderBuffer* buffer = (RenderBuffer*)malloc(sizeof(RenderBuffer));
+   int written = buffer != NULL;
+   if (written) {
+     buffer->used = 0;
+     buffer->fd = fileno(file);
+     written = writeBoats(store, 0, store->count, buffer);
+     free(buffer);
+   }
+   
+   if (!written) {
+     fclose(file);
+     unlink(tempPath);
+     free(tempPath);
+     printf("Error: Could not write file %s.\n", filename);
+     return 0;
+   }
+   return replaceWithTempFile(file, tempPath, filename);
+ }
+ 
+ /* Collect finished inventory writers, or wait for all of them, reporting any that failed */
+ void reapInventoryWriters(int block) {
+   pid_t pid;
+   int status;
+   
+   while ((pid = waitpid(-1, &status, block ? 0 : WNOHANG)) > 0 || (pid == -1 && block && errno == EINTR)) {
+     if (pid > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+       printf("Error: Background inventory write (process %d) failed.\n\n", (int)pid);
+     }
+   }
+ }
+ 
+ /* Add a boat to the inventory */
+ int addBoat(BoatStore* store, const char* boatData) {
+   /* Allocate memory for new boat */
+   Boat* newBoat = allocateBoat(&store->pool);
+   if (newBoat == NULL) {
+     printf("Error: Memory allocation failed.\n\n");
+     return 0;
+   }
+   
+   /* Parse CSV line with the same parser that loads files */
+   int64_t centsOwed;
+   RecordError error = parseBoatRecord(boatData, boatData + strlen(boatData), newBoat, &centsOwed, &store->names);
+   if (error != RECORD_OK) {
+     releaseBoat(&store->pool, newBoat);
+     if (error == RECORD_OUT_OF_MEMORY) {
+       printf("Error: Memory allocation failed.\n\n");
+     } 
+     else if (error == RECORD_BAD_LOCATION_TYPE) {
+       printf("Error: Invalid location type.\n\n");
+     } 
+     else if (error == RECORD_BAD_LENGTH) {
+       printf("Error: Boat length must be 0 to %d feet.\n\n", MAX_BOAT_LENGTH);
+     } 
+     else if (error == RECORD_BAD_LOCATION) {
+       printf("Error: Slip or storage space number must be 0 to %d.\n\n", MAX_TRACKED_PLACE);
+     } else {
+       printf("Error: Invalid boat data format.\n\n");
+     }
+     return 0;
+   }
+   
+   if (!attachHotSlot(&store->hot, newBoat, centsOwed)) {
+     releaseBoatName(&store->names, newBoat);
+     releaseBoat(&store->pool, newBoat);
+     printf("Error: Memory allocation failed.\n\n");
+     return 0;
+   }
+   
+   /* Insert boat in name order (binary search instead of re-sorting everything) */
+   if (!insertBoatAt(store, findInsertPosition(store, newBoat->name), newBoat)) {
+     detachHotSlot(&store->hot, newBoat);
+     releaseBoatName(&store->names, newBoat);
+     releaseBoat(&store->pool, newBoat);
+     printf("Error: Memory allocation failed.\n\n");
+     return 0;
+   }
+   
+   journalAppend(&store->journal, "A %s\n", boatData);
+   markAllDirty(store);
+   return 1;
+ }
+ 
+ /* Remove a boat from the inventory */
+ void removeBoat(BoatStore* store) {
+   char name[MAX_NAME_LENGTH];
+   
+   printf("Please enter the boat name                               : ");
+   if (fgets(name, sizeof(name), stdin) != NULL) {
+     name[strcspn(name, "\n")] = '\0'; /* Remove newline */
+     removeBoatByName(store, name);
+   }
+ }
+ 
+ /* Remove the boat with the given name (case insensitive; returns 0 if there is none) */
+ int removeBoatByName(BoatStore* store, const char* name) {
+   /* Find the boat's position; the gap has to be closed there anyway */
+   int index = findBoatIndex(store, name);
+   
+   if (index == -1) {
+     printf("No boat with that name\n\n");
+     return 0;
+   }
+   
+   Boat* boat = store->boats[index];
+   journalAppend(&store->journal, "R %s\n", boat->name);
+   markAllDirty(store);
+   
+   /* Close the gap and free boat memory */
+   invalidateRow(&store->rows, boat->slot);
+   removeBoatAt(store, index);
+   detachHotSlot(&store->hot, boat);
+   releaseBoatName(&store->names, boat);
+   releaseBoat(&store->pool, boat);
+   return 1;
+ }
+ 
+ /* Report an unknown boat name for a payment, suggesting boats that start with it */
+ void reportMissingBoat(BoatStore* store, const char* name) {
+   int first;
+   int count = findBoatsWithPrefix(store, name, &first);
+   
+   printf("No boat with that name\n");
+   if (name[0] != '\0' && count > 0) {
+     printf("Boats starting with \"%s\":\n", name);
+     displayBoats(store, first, count < MAX_SUGGESTIONS ? count : MAX_SUGGESTIONS);
+   }
+   printf("\n");
+ }
+ 
+ /* Accept payment for a boat */
+ void acceptPayment(BoatStore* store) {
+   char name[MAX_NAME_LENGTH];
+   
+   printf("Please enter the boat name                               : ");
+   if (fgets(name, sizeof(name), stdin) != NULL) {
+     name[strcspn(name, "\n")] = '\0'; /* Remove newline */
+     
+     /* Find boat */
+     Boat* boat = findBoatByName(store, name);
+     
+     if (boat == NULL) {
+       reportMissingBoat(store, name);
+       return;
+     }
+     
+     printf("Please enter the amount to be paid                       : ");
+     char buffer[50];
+     if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
+       applyPayment(store, boat, parseCents(buffer));
+     }
+   }
+ }
+ 
+ /* Apply a payment to a boat, up to the amount owed (returns 0 if it is too large) */
+ int applyPayment(BoatStore* store, Boat* boat, int64_t payment) {
+   int64_t* centsOwed = &store->hot.centsOwed[boat->slot];
+   
+   /* Check if payment amount is valid */
+   if (payment > *centsOwed) {
+     char owed[32];
+     formatCents(owed, sizeof(owed), *centsOwed);
+     printf("That is more than the amount owed, $%s\n\n", owed);
+     return 0;
+   }
+   
+   /* A negative payment adds to the balance, which must stay within range */
+   if (payment < 0 && *centsOwed > MAX_CENTS + payment) {
+     printf("That would take the amount owed past $%lld.%02lld\n\n", (long long)(MAX_CENTS / 100), (long long)(MAX_CENTS % 100));
+     return 0;
+   }
+   
+   /* Update amount owed */
+   *centsOwed -= payment;
+   invalidateRow(&store->rows, boat->slot);
+   markBoatDirty(store, boat);
+   
+   /* Journal the exact cents; large amounts would not survive a round trip through a double */
+   char amount[32];
+   formatCents(amount, sizeof(amount), payment);
+   journalAppend(&store->journal, "P %s,%s\n", boat->name, amount);
+   return 1;
+ }
+ 
+ /* Accept payment for the boat with the given name (case insensitive) */
+ void payBoatByName(BoatStore* store, const char* name, int64_t payment) {
+   Boat* boat = findBoatByName(store, name);
+   
+   if (boat == NULL) {
+     reportMissingBoat(store, name);
+     return;
+   }
+   
+   applyPayment(store, boat, payment);
+ }
+ 
+ /* Update monthly charges for all boats */
+ void updateMonthlyCharges(BoatStore* store) {
+   HotColumns* hot = &store->hot;
+   
+   /* Stream through the columns; released slots have zero length and are charged nothing */
+   selectChargeKernel()(hot->lengths, hot->locationTypes, hot->centsOwed, hot->count);
+   invalidateAllRows(&store->rows);
+   
+   journalAppend(&store->journal, "M\n");
+   markAllDirty(store);
+ }
+ 
+ /*
+  * Balances are whole cents and every kernel adds length * rate in exact 64-bit integer
+  * arithmetic, so month-end charges never drift and do not depend on the CPU.
+  */
+ 
+ /* Portable month-end kernel */
+ void chargeMonthScalar(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count) {
+   for (int i = 0; i < count; i++) {
+     centsOwed[i] += lengths[i] * monthlyRates[locationTypes[i]];
+   }
+ }
+ 
+ #ifdef HAVE_X86_KERNELS
+ /* SSE2 month-end kernel: two boats per step, rates looked up one by one */
+ __attribute__((target("sse2")))
+ void chargeMonthSSE2(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count) {
+   int i = 0;
+   
+   for (; i + 2 <= count; i += 2) {
+     __m128i length = _mm_set_epi32(0, lengths[i + 1], 0, lengths[i]);
+     __m128i rates = _mm_set_epi64x(monthlyRates[locationTypes[i + 1]], monthlyRates[locationTypes[i]]);
+     
+     /* SSE2 only multiplies unsigned 32-bit lanes, so take rate << 32 back off for negative lengths */
+     __m128i negative = _mm_shuffle_epi32(_mm_srai_epi32(length, 31), _MM_SHUFFLE(2, 2, 0, 0));
+     __m128i charges = _mm_sub_epi64(_mm_mul_epu32(length, rates), _mm_and_si128(negative, _mm_slli_epi64(rates, 32)));
+     __m128i owed = _mm_loadu_si128((const __m128i*)(centsOwed + i));
+     _mm_storeu_si128((__m128i*)(centsOwed + i), _mm_add_epi64(owed, charges));
+   }
+   
+   chargeMonthScalar(lengths + i, locationTypes + i, centsOwed + i, count - i);
+ }
+ 
+ /* AVX2 month-end kernel: four boats per step, rates gathered from the rate table */
+ __attribute__((target("avx2")))
+ void chargeMonthAVX2(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count) {
+   int i = 0;
+   
+   for (; i + 4 <= count; i += 4) {
+     int packedTypes;
+     memcpy(&packedTypes, locationTypes + i, sizeof(packedTypes));
+     __m128i types = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packedTypes));
+     __m256i rates = _mm256_i32gather_epi64((const long long*)monthlyRates, types, sizeof(int64_t));
+     __m256i length = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(lengths + i)));
+     __m256i charges = _mm256_mul_epi32(length, rates);
+     __m256i owed = _mm256_loadu_si256((const __m256i*)(centsOwed + i));
+     _mm256_storeu_si256((__m256i*)(centsOwed + i), _mm256_add_epi64(owed, charges));
+   }
+   
+   chargeMonthScalar(lengths + i, locationTypes + i, centsOwed + i, count - i);
+ }
+ 
+ /* AVX-512 month-end kernel: eight boats per step, rates gathered from the rate table */
+ __attribute__((target("avx512f")))
+ void chargeMonthAVX512(const int32_t* lengths, const unsigned char* locationTypes, int64_t* centsOwed, int count) {
+   int i = 0;
+   
+   for (; i + 8 <= count; i += 8) {
+     __m256i types = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(locationTypes + i)));
+     __m512i rates = _mm512_i32gather_epi64(types, monthlyRates, sizeof(int64_t));
+     __m512i length = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(lengths + i)));
+     __m512i charges = _mm512_mul_epi32(length, rates);
+     __m512i owed = _mm512_loadu_si512(centsOwed + i);
+     _mm512_storeu_si512(centsOwed + i, _mm512_add_epi64(owed, charges));
+   }
+   
+   chargeMonthScalar(lengths + i, locationTypes + i, centsOwed + i, count - i);
+ }
+ #endif
+ 
+ /* Pick the widest month-end kernel the CPU supports */
+ ChargeKernel selectChargeKernel() {
+ #ifdef HAVE_X86_KERNELS
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f")) {
+     return chargeMonthAVX512;
+   }
+   if (__builtin_cpu_supports("avx2")) {
+     return chargeMonthAVX2;
+   }
+   if (__builtin_cpu_supports("sse2")) {
+     return chargeMonthSSE2;
+   }
+ #endif
+   return chargeMonthScalar;
+ }
+ 
+ /* Convert location type to string */
+ char* locationTypeToString(LocationType type) {
+   switch (type) {
+     case SLIP:
+       return "slip";
+     case LAND:
+       return "land";
+     case TRAILOR:
+       return "trailor";
+     case STORAGE:
+       return "storage";
+     default:
+       return "unknown";
+   }
+ }
+ 
+ /* Copy a name into the arena after its sort key, followed by an optional trailor tag (NULL on failure) */
+ const char* internName(NameArena* arena, const char* name, size_t nameLength, const char* tag, size_t tagLength) {
+   NameBlock* block = arena->blocks;
+   size_t size = nameEntrySize(nameLength, tag, tagLength);
+   char* entry;
+   
+   if (size / 8 < NAME_SIZE_CLASSES && arena->freeEntries[size / 8] != NULL) {
+     /* Reuse the entry of a released name of the same size */
+     entry = arena->freeEntries[size / 8];
+     memcpy(&arena->freeEntries[size / 8], entry, sizeof(char*));
+   } else {
+     if (block == NULL || block->size - block->used < size) {
+       size_t blockSize = size > NAME_BLOCK_BYTES ? size : NAME_BLOCK_BYTES;
+       block = (NameBlock*)malloc(sizeof(NameBlock) + blockSize);
+       if (block == NULL) {
+         return NULL;
+       }
+       block->next = arena->blocks;
+       block->used = 0;
+       block->size = blockSize;
+       arena->blocks = block;
+     }
+     entry = block->text + block->used;
+     block->used += size; /* Sizes are multiples of 8, so sort keys stay aligned */
+   }
+   
+   char* text = entry + sizeof(uint64_t);
+   memcpy(text, name, nameLength);
+   text[nameLength] = '\0';
+   if (tag != NULL) {
+     memcpy(text + nameLength + 1, tag, tagLength);
+     text[nameLength + 1 + tagLength] = '\0';
+   }
+   uint64_t key = foldNameKey(text);
+   memcpy(entry, &key, sizeof(key));
+   
+   return text;
+ }
+ 
+ /* Bytes taken in the arena by a name with its sort key and optional trailor tag, rounded up to 8 */
+ size_t nameEntrySize(size_t nameLength, const char* tag, size_t tagLength) {
+   size_t size = sizeof(uint64_t) + nameLength + 1 + (tag != NULL ? tagLength + 1 : 0);
+   
+   return (size + 7) & ~(size_t)7;
+ }
+ 
+ /* Keep the arena entry of a removed boat's name for the next name of the same size */
+ void releaseBoatName(NameArena* arena, const Boat* boat) {
+   const char* tag = boatLocationType(boat) == TRAILOR ? boatTrailorTag(boat) : NULL;
+   size_t size = nameEntrySize(strlen(boat->name), tag, tag != NULL ? strlen(tag) : 0);
+   char* entry = (char*)boat->name - sizeof(uint64_t);
+   
+   if (size / 8 < NAME_SIZE_CLASSES) {
+     memcpy(entry, &arena->freeEntries[size / 8], sizeof(char*));
+     arena->freeEntries[size / 8] = entry;
+   }
+ }
+ 
+ /* Move all blocks of one arena into another; names keep their addresses */
+ void mergeNameArenas(NameArena* into, NameArena* from) {
+   NameBlock* last = from->blocks;
+   
+   if (last == NULL) {
+     return;
+   }
+   while (last->next != NULL) {
+     last = last->next;
+   }
+   
+   /* Keep the receiving arena's newest block in front, where new names go */
+   if (into->blocks == NULL) {
+     into->blocks = from->blocks;
+   } else {
+     last->next = into->blocks->next;
+     into->blocks->next = from->blocks;
+   }
+   from->blocks = NULL;
+ }
+ 
+ /* Free every block of a name arena */
+ void freeNameArena(NameArena* arena) {
+   while (arena->blocks != NULL) {
+     NameBlock* next = arena->blocks->next;
+     free(arena->blocks);
+     arena->blocks = next;
+   }
+   memset(arena->freeEntries, 0, sizeof(arena->freeEntries));
+ }
+ 
+ /* Take a boat from the free list, or from the newest slab, adding a larger slab when full */
+ Boat* allocateBoat(BoatPool* pool) {
+   if (pool->freeList != NULL) {
+     BoatSlot* slot = pool->freeList;
+     pool->freeList = slot->nextFree;
+     return &slot->boat;
+   }
+   
+   if (pool->slabs == NULL || pool->slabs->used == pool->slabs->capacity) {
+     int capacity = pool->slabs == NULL ? INITIAL_SLAB_BOATS : pool->slabs->capacity * 2;
+     BoatSlab* slab = (BoatSlab*)malloc(sizeof(BoatSlab) + (size_t)capacity * sizeof(BoatSlot));
+     if (slab == NULL) {
+       return NULL;
+     }
+     slab->next = pool->slabs;
+     slab->capacity = capacity;
+     slab->used = 0;
+     pool->slabs = slab;
+   }
+   
+   return &pool->slabs->slots[pool->slabs->used++].boat;
+ }
+ 
+ /* Return a boat to the pool's free list */
+ void releaseBoat(BoatPool* pool, Boat* boat) {
+   BoatSlot* slot = (BoatSlot*)boat;
+   
+   slot->nextFree = pool->freeList;
+   pool->freeList = slot;
+ }
+ 
+ /* Release every boat at once by freeing the slabs */
+ void releaseAllBoats(BoatPool* pool) {
+   while (pool->slabs != NULL) {
+     BoatSlab* next = pool->slabs->next;
+     free(pool->slabs);
+     pool->slabs = next;
+   }
+   
+   pool->freeList = NULL;
+ }
+ 
+ /* Double the capacity of the hot columns (returns 0 on failure) */
+ int growHotColumns(HotColumns* hot) {
+   int capacity = hot->capacity == 0 ? INITIAL_STORE_CAPACITY : hot->capacity * 2;
+   int32_t* lengths = (int32_t*)realloc(hot->lengths, (size_t)capacity * sizeof(int32_t));
+   if (lengths != NULL) {
+     hot->lengths = lengths;
+   }
+   unsigned char* locationTypes = (unsigned char*)realloc(hot->locationTypes, (size_t)capacity);
+   if (locationTypes != NULL) {
+     hot->locationTypes = locationTypes;
+   }
+   int64_t* centsOwed = (int64_t*)realloc(hot->centsOwed, (size_t)capacity * sizeof(int64_t));
+   if (centsOwed != NULL) {
+     hot->centsOwed = centsOwed;
+   }
+   unsigned char* dirty = (unsigned char*)realloc(hot->dirty, (size_t)capacity);
+   if (dirty != NULL) {
+     hot->dirty = dirty;
+   }
+   int* freeSlots = (int*)realloc(hot->freeSlots, (size_t)capacity * sizeof(int));
+   if (freeSlots != NULL) {
+     hot->freeSlots = freeSlots;
+   }
+   
+   if (lengths == NULL || locationTypes == NULL || centsOwed == NULL || dirty == NULL || freeSlots == NULL) {
+     return 0;
+   }
+   hot->capacity = capacity;
+   return 1;
+ }
+ 
+ /* Give a boat a slot in the hot columns and fill it in (returns 0 on failure) */
+ int attachHotSlot(HotColumns* hot, Boat* boat, int64_t centsOwed) {
+   int slot;
+   
+   if (hot->freeCount > 0) {
+     slot = hot->freeSlots[--hot->freeCount];
+   } else {
+     if (hot->count == hot->capacity && !growHotColumns(hot)) {
+       return 0;
+     }
+     slot = hot->count++;
+   }
+   
+   hot->lengths[slot] = boatLength(boat);
+   hot->locationTypes[slot] = (unsigned char)boatLocationType(boat);
+   hot->centsOwed[slot] = centsOwed;
+   hot->dirty[slot] = 0;
+   boat->slot = slot;
+   return 1;
+ }
+ 
+ /* Round a boat length to the whole feet billed and saved ("%.0f" rounds halves to even) */
+ int32_t wholeFeet(float length) {
+   if (!(length > -1e9f && length < 1e9f)) {
+     return length > 0 ? 1000000000 : length < 0 ? -1000000000 : 0; /* Out of range or NaN */
+   }
+   
+   int32_t feet = (int32_t)length;
+   float fraction = length - (float)feet;
+   if (fraction > 0.5f || (fraction == 0.5f && (feet & 1))) {
+     feet++;
+   } 
+   else if (fraction < -0.5f || (fraction == -0.5f && (feet & 1))) {
+     feet--;
+   }
+   
+   return feet;
+ }
+ 
+ /* Release a boat's slot in the hot columns; the cleared slot adds nothing when billed */
+ void detachHotSlot(HotColumns* hot, Boat* boat) {
+   hot->lengths[boat->slot] = 0;
+   hot->locationTypes[boat->slot] = SLIP;
+   hot->centsOwed[boat->slot] = 0;
+   hot->freeSlots[hot->freeCount++] = boat->slot;
+ }
+ 
+ /* Initialize an empty boat store */
+ void initBoatStore(BoatStore* store) {
+   store->boats = NULL;
+   store->count = 0;
+   store->capacity = 0;
+   store->index.slots = NULL;
+   store->index.hashes = NULL;
+   store->index.sharers = NULL;
+   store->index.capacity = 0;
+   store->index.count = 0;
+   memset(&store->names, 0, sizeof(store->names));
+   memset(&store->locations, 0, sizeof(store->locations));
+   store->locations.slips.places = MAX_SLIP_NUM;
+   store->locations.storage.places = MAX_STORAGE_SPACE;
+   store->pool.slabs = NULL;
+   store->pool.freeList = NULL;
+   memset(&store->hot, 0, sizeof(store->hot));
+   memset(&store->rows, 0, sizeof(store->rows));
+   store->page.first = 0;
+   store->page.next = 0;
+   store->page.size = DEFAULT_PAGE_SIZE;
+   store->dirtyBoats = NULL;
+   store->dirtyCount = 0;
+   store->dirtyCapacity = 0;
+   store->allDirty = 0;
+ }
+ 
+ /* Make room for at least the given number of boats, doubling capacity (returns 0 on failure) */
+ int reserveBoats(BoatStore* store, int needed) {
+   if (needed <= store->capacity) {
+     return 1;
+   }
+   
+   int capacity = store->capacity == 0 ? INITIAL_STORE_CAPACITY : store->capacity;
+   while (capacity < needed) {
+     if (capacity > (1 << 29)) {
+       return 0;
+     }
+     capacity *= 2;
+   }
+   
+   Boat** grown = (Boat**)realloc(store->boats, (size_t)capacity * sizeof(Boat*));
+   if (grown == NULL) {
+     return 0;
+   }
+   store->boats = grown;
+   store->capacity = capacity;
+   return 1;
+ }
+ 
+ /* Append a boat to the store and its name index (returns 0 on failure) */
+ int appendBoat(BoatStore* store, Boat* boat) {
+   return insertBoatAt(store, store->count, boat);
+ }
+ 
+ /* Binary search for where a name belongs in the sorted store (after any equal names) */
+ int findInsertPosition(BoatStore* store, const char* name) {
+   uint64_t key = foldNameKey(name);
+   int low = 0;
+   int high = store->count;
+   
+   while (low < high) {
+     int middle = low + (high - low) / 2;
+     Boat* boat = store->boats[middle];
+     if (compareNameKeys(boatSortKey(boat), boat->name, key, name) <= 0) {
+       low = middle + 1;
+     } else {
+       high = middle;
+     }
+   }
+   
+   return low;
+ }
+ 
+ /* Insert a boat at the given index, shifting later boats up (returns 0 on failure) */
+ int insertBoatAt(BoatStore* store, int index, Boat* boat) {
+   if (!reserveBoats(store, store->count + 1) || !trackLocation(&store->locations, boat)) {
+     return 0;
+   }
+   if (!indexBoat(&store->index, boat)) {
+     untrackLocation(&store->locations, boat);
+     return 0;
+   }
+   
+   memmove(&store->boats[index + 1], &store->boats[index],
+           (size_t)(store->count - index) * sizeof(Boat*));
+   store->boats[index] = boat;
+   store->count++;
+   shiftPageCursor(&store->page, index, 1);
+   return 1;
+ }
+ 
+ /* Remove the boat pointer at the given index, keeping the store packed and in order */
+ void removeBoatAt(BoatStore* store, int index) {
+   Boat* boat = store->boats[index];
+   Boat* sharer = NULL;
+   
+   /* Boats sharing the name are its neighbours in the sorted store */
+   if (index + 1 < store->count && compareBoatKeys(store->boats[index + 1], boat) == 0) {
+     sharer = store->boats[index + 1];
+   } 
+   else if (index > 0 && compareBoatKeys(store->boats[index - 1], boat) == 0) {
+     sharer = store->boats[index - 1];
+   }
+   unindexBoat(&store->index, boat, sharer);
+   untrackLocation(&store->locations, boat);
+   shiftPageCursor(&store->page, index, -1);
+   memmove(&store->boats[index], &store->boats[index + 1],
+           (size_t)(store->count - index - 1) * sizeof(Boat*));
+   store->count--;
+ }
+ 
+ /* Binary search for the first boat whose name is not before the given one (case insensitive) */
+ int findLowerBound(BoatStore* store, const char* name) {
+   uint64_t key = foldNameKey(name);
+   int low = 0;
+   int high = store->count;
+   
+   while (low < high) {
+     int middle = low + (high - low) / 2;
+     Boat* boat = store->boats[middle];
+     if (compareNameKeys(boatSortKey(boat), boat->name, key, name) < 0) {
+       low = middle + 1;
+     } else {
+       high = middle;
+     }
+   }
+   
+   return low;
+ }
+ 
+ /* Find the index of the first boat with exactly this name (case insensitive) using the sort order */
+ int findBoatIndex(BoatStore* store, const char* name) {
+   int index = findLowerBound(store, name);
+   
+   if (index < store->count && strcasecmp(store->boats[index]->name, name) == 0) {
+     return index;
+   }
+   
+   return -1; /* Boat not found */
+ }
+ 
+ /* Find the run of boats whose names start with a prefix (case insensitive); returns its length */
+ int findBoatsWithPrefix(BoatStore* store, const char* prefix, int* first) {
+   size_t prefixLength = strlen(prefix);
+   int low = findLowerBound(store, prefix);
+   int high = store->count;
+   
+   /* Names sharing the prefix sort together, so the run ends at the first name past it */
+   *first = low;
+   while (low < high) {
+     int middle = low + (high - low) / 2;
+     if (strncasecmp(store->boats[middle]->name, prefix, prefixLength) <= 0) {
+       low = middle + 1;
+     } else {
+       high = middle;
+     }
+   }
+   
+   return low - *first;
+ }
+ 
+ /* Find the position of a boat in the store */
+ int indexOfBoat(BoatStore* store, Boat* boat) {
+   /* Boats with equal names are adjacent, so only that run needs scanning */
+   for (int i = findLowerBound(store, boat->name); i < store->count; i++) {
+     if (store->boats[i] == boat) {
+       return i;
+     }
+   }
+   
+   return -1; /* Boat not in store */
+ }
+ 
+ /* Hash a boat name with case folded (FNV-1a over lower-case characters) */
+ unsigned int hashBoatName(const char* name) {
+   unsigned int hash = 2166136261u;
+   
+   for (const unsigned char* c = (const unsigned char*)name; *c != '\0'; c++) {
+     hash ^= (unsigned int)tolower(*c);
+     hash *= 16777619u;
+   }
+   
+   return hash;
+ }
+ 
+ /* Double the slot count of the name index, reinserting boats by their stored hashes */
+ int growNameIndex(NameIndex* index) {
+   int capacity = index->capacity == 0 ? INITIAL_INDEX_CAPACITY : index->capacity * 2;
+   Boat** slots = (Boat**)calloc((size_t)capacity, sizeof(Boat*));
+   unsigned int* hashes = (unsigned int*)malloc((size_t)capacity * sizeof(unsigned int));
+   int* sharers = (int*)malloc((size_t)capacity * sizeof(int));
+   
+   if (slots == NULL || hashes == NULL || sharers == NULL) {
+     free(slots);
+     free(hashes);
+     free(sharers);
+     return 0;
+   }
+   
+   for (int i = 0; i < index->capacity; i++) {
+     if (index->slots[i] != NULL) {
+       int slot = (int)(index->hashes[i] & (unsigned int)(capacity - 1));
+       while (slots[slot] != NULL) {
+         slot = (slot + 1) & (capacity - 1);
+       }
+       slots[slot] = index->slots[i];
+       hashes[slot] = index->hashes[i];
+       sharers[slot] = index->sharers[i];
+     }
+   }
+   
+   free(index->slots);
+   free(index->hashes);
+   free(index->sharers);
+   index->slots = slots;
+   index->hashes = hashes;
+   index->sharers = sharers;
+   index->capacity = capacity;
+   return 1;
+ }
+ 
+ /* Grow the name index ahead of adding up to the given number of names (returns 0 on failure) */
+ int reserveNameIndex(NameIndex* index, int names) {
+   while ((long long)index->capacity < (long long)names * 2) {
+     if (!growNameIndex(index)) {
+       return 0;
+     }
+   }
+   
+   return 1;
+ }
+ 
+ /* Find the slot holding a name, or the empty slot where it belongs */
+ int findIndexSlot(NameIndex* index, const char* name, unsigned int hash) {
+   uint64_t key = foldNameKey(name);
+   int mask = index->capacity - 1;
+   int slot = (int)(hash & (unsigned int)mask);
+   
+   /* Linear probing */
+   while (index->slots[slot] != NULL) {
+     Boat* boat = index->slots[slot];
+     if (index->hashes[slot] == hash && compareNameKeys(boatSortKey(boat), boat->name, key, name) == 0) {
+       break;
+     }
+     slot = (slot + 1) & mask;
+   }
+   
+   return slot;
+ }
+ 
+ /* Add a boat to the name index, or count it if its name is indexed already (returns 0 on failure) */
+ int indexBoat(NameIndex* index, Boat* boat) {
+   if ((index->count + 1) * 2 > index->capacity && !growNameIndex(index)) {
+     return 0;
+   }
+   
+   unsigned int hash = hashBoatName(boat->name);
+   int slot = findIndexSlot(index, boat->name, hash);
+   
+   if (index->slots[slot] != NULL) {
+     index->sharers[slot]++;
+     return 1;
+   }
+   index->slots[slot] = boat;
+   index->hashes[slot] = hash;
+   index->sharers[slot] = 1;
+   index->count++;
+   return 1;
+ }
+ 
+ /* Remove a boat from the name index; sharer is another boat with its name, if there is one */
+ void unindexBoat(NameIndex* index, Boat* boat, Boat* sharer) {
+   if (index->count == 0) {
+     return;
+   }
+   
+   int mask = index->capacity - 1;
+   int slot = findIndexSlot(index, boat->name, hashBoatName(boat->name));
+   
+   if (index->slots[slot] == NULL) {
+     return; /* Boat not indexed */
+   }
+   if (--index->sharers[slot] > 0) {
+     if (index->slots[slot] == boat) {
+       index->slots[slot] = sharer;
+     }
+     return;
+   }
+   
+   /* Backward-shift deletion keeps probe runs intact without tombstones */
+   int hole = slot;
+   for (int following = (hole + 1) & mask; index->slots[following] != NULL; following = (following + 1) & mask) {
+     int home = (int)(index->hashes[following] & (unsigned int)mask);
+     
+     /* Move the entry only if its home slot is not between the hole and its position */
+     if (((following - home) & mask) >= ((following - hole) & mask)) {
+       index->slots[hole] = index->slots[following];
+       index->hashes[hole] = index->hashes[following];
+       index->sharers[hole] = index->sharers[following];
+       hole = following;
+     }
+   }
+   index->slots[hole] = NULL;
+   index->count--;
+ }
+ 
+ /*
+  * Find a boat by name (case insensitive) through the name index. When several boats share
+  * the name, the first of them in sort order is returned, found by binary search in the
+  * sorted store, so the choice never depends on how the boats were indexed.
+  */
+ Boat* findBoatByName(BoatStore* store, const char* name) {
+   NameIndex* index = &store->index;
+   
+   if (index->count == 0) {
+     return NULL;
+   }
+   
+   int slot = findIndexSlot(index, name, hashBoatName(name));
+   if (index->slots[slot] == NULL) {
+     return NULL; /* Boat not found */
+   }
+   if (index->sharers[slot] > 1) {
+     return store->boats[findBoatIndex(store, name)]; /* Shared name */
+   }
+   
+   return index->slots[slot];
+ }
+ 
+ /* Count a boat in a numbered place, growing the bitmap as needed (returns 0 on failure) */
+ int occupyPlace(Occupancy* occupancy, int place) {
+   if (place < 1 || place > MAX_TRACKED_PLACE) {
+     return 1; /* Not a trackable place number */
+   }
+   
+   if (place >= occupancy->capacity) {
+     int capacity = occupancy->capacity == 0 ? 128 : occupancy->capacity;
+     while (capacity <= place) {
+       capacity *= 2;
+     }
+     
+     uint64_t* taken = (uint64_t*)realloc(occupancy->taken, (size_t)(capacity / 64) * sizeof(uint64_t));
+     if (taken != NULL) {
+       occupancy->taken = taken;
+     }
+     int* holders = (int*)realloc(occupancy->holders, (size_t)capacity * sizeof(int));
+     if (holders != NULL) {
+       occupancy->holders = holders;
+     }
+     if (taken == NULL || holders == NULL) {
+       return 0;
+     }
+     
+     memset(taken + occupancy->capacity / 64, 0, (size_t)((capacity - occupancy->capacity) / 64) * sizeof(uint64_t));
+     memset(holders + occupancy->capacity, 0, (size_t)(capacity - occupancy->capacity) * sizeof(int));
+     occupancy->capacity = capacity;
+   }
+   
+   occupancy->holders[place]++;
+   occupancy->taken[place / 64] |= 1ull << (place % 64);
+   return 1;
+ }
+ 
+ /* Stop counting a boat in a numbered place */
+ void vacatePlace(Occupancy* occupancy, int place) {
+   if (place < 1 || place >= occupancy->capacity || occupancy->holders[place] == 0) {
+     return;
+   }
+   
+   if (--occupancy->holders[place] == 0) {
+     occupancy->taken[place / 64] &= ~(1ull << (place % 64));
+   }
+ }
+ 
+ /* Check whether no boat is assigned to a place (places below 1 are never free) */
+ int isPlaceFree(const Occupancy* occupancy, int place) {
+   if (place < 1) {
+     return 0; /* Places are numbered from 1 */
+   }
+   return place >= occupancy->capacity || !(occupancy->taken[place / 64] & (1ull << (place % 64)));
+ }
+ 
+ /* Find the lowest free place from 1 to limit (returns 0 if all are taken) */
+ int findFreePlace(const Occupancy* occupancy, int limit) {
+   /* Scan a word at a time; place 0 does not exist, so treat it as taken */
+   for (int word = 0; word * 64 <= limit; word++) {
+     uint64_t taken = word * 64 < occupancy->capacity ? occupancy->taken[word] : 0;
+     if (word == 0) {
+       taken |= 1;
+     }
+     
+     if (~taken != 0) {
+       int place = word * 64 + __builtin_ctzll(~taken);
+       return place <= limit ? place : 0;
+     }
+   }
+   
+   return 0;
+ }
+ 
+ /* Find the holder count of a trailor tag, adding the tag if asked (returns NULL if absent or on failure) */
+ int* findTagHolders(TagIndex* index, const char* tag, int create) {
+   if (tag[0] == '\0') {
+     return NULL;
+   }
+   if (create && (index->count + 1) * 2 > index->capacity && !growTagIndex(index)) {
+     return NULL;
+   }
+   if (index->capacity == 0) {
+     return NULL;
+   }
+   
+   int mask = index->capacity - 1;
+   int slot = (int)(hashBoatName(tag) & (unsigned int)mask);
+   while (index->tags[slot][0] != '\0') {
+     if (strcmp(index->tags[slot], tag) == 0) {
+       return &index->holders[slot];
+     }
+     slot = (slot + 1) & mask;
+   }
+   
+   if (!create) {
+     return NULL;
+   }
+   strcpy(index->tags[slot], tag);
+   index->holders[slot] = 0;
+   index->count++;
+   return &index->holders[slot];
+ }
+ 
+ /* Double the capacity of the trailor tag table (returns 0 on failure) */
+ int growTagIndex(TagIndex* index) {
+   int capacity = index->capacity == 0 ? INITIAL_INDEX_CAPACITY : index->capacity * 2;
+   char (*tags)[10] = calloc((size_t)capacity, sizeof(*tags));
+   int* holders = (int*)malloc((size_t)capacity * sizeof(int));
+   
+   if (tags == NULL || holders == NULL) {
+     free(tags);
+     free(holders);
+     return 0;
+   }
+   
+   for (int i = 0; i < index->capacity; i++) {
+     if (index->tags[i][0] != '\0') {
+       int slot = (int)(hashBoatName(index->tags[i]) & (unsigned int)(capacity - 1));
+       while (tags[slot][0] != '\0') {
+         slot = (slot + 1) & (capacity - 1);
+       }
+       memcpy(tags[slot], index->tags[i], sizeof(tags[slot]));
+       holders[slot] = index->holders[i];
+     }
+   }
+   
+   free(index->tags);
+   free(index->holders);
+   index->tags = tags;
+   index->holders = holders;
+   index->capacity = capacity;
+   return 1;
+ }
+ 
+ /* Record where a boat is kept (returns 0 on failure) */
+ int trackLocation(LocationIndex* locations, Boat* boat) {
+   int* holders;
+   
+   switch (boatLocationType(boat)) {
+     case SLIP:
+       return occupyPlace(&locations->slips, boatSlipNumber(boat));
+     case LAND:
+       locations->bayHolders[(unsigned char)boatBayLetter(boat)]++;
+       return 1;
+     case TRAILOR:
+       holders = findTagHolders(&locations->trailors, boatTrailorTag(boat), 1);
+       if (holders == NULL) {
+         return boatTrailorTag(boat)[0] == '\0';
+       }
+       (*holders)++;
+       return 1;
+     case STORAGE:
+       return occupyPlace(&locations->storage, boatStorageSpace(boat));
+   }
+   
+   return 1;
+ }
+ 
+ /* Forget where a boat was kept */
+ void untrackLocation(LocationIndex* locations, Boat* boat) {
+   int* holders;
+   
+   switch (boatLocationType(boat)) {
+     case SLIP:
+       vacatePlace(&locations->slips, boatSlipNumber(boat));
+       break;
+     case LAND:
+       locations->bayHolders[(unsigned char)boatBayLetter(boat)]--;
+       break;
+     case TRAILOR:
+       holders = findTagHolders(&locations->trailors, boatTrailorTag(boat), 0);
+       if (holders != NULL && *holders > 0) {
+         (*holders)--;
+       }
+       break;
+     case STORAGE:
+       vacatePlace(&locations->storage, boatStorageSpace(boat));
+       break;
+   }
+ }
+ 
+ /* Warn about slips and storage spaces assigned to several boats, and reused trailor tags */
+ void reportDoubleBookings(BoatStore* store) {
+   LocationIndex* locations = &store->locations;
+   int found = 0;
+   
+   for (int place = 1; place < locations->slips.capacity; place++) {
+     if (locations->slips.holders[place] > 1 && found++ < MAX_BOOKING_WARNINGS) {
+       printf("Warning: Slip %d is assigned to %d boats.\n", place, locations->slips.holders[place]);
+     }
+   }
+   for (int place = 1; place < locations->storage.capacity; place++) {
+     if (locations->storage.holders[place] > 1 && found++ < MAX_BOOKING_WARNINGS) {
+       printf("Warning: Storage space %d is assigned to %d boats.\n", place, locations->storage.holders[place]);
+     }
+   }
+   for (int slot = 0; slot < locations->trailors.capacity; slot++) {
+     if (locations->trailors.tags[slot][0] != '\0' && locations->trailors.holders[slot] > 1 &&
+         found++ < MAX_BOOKING_WARNINGS) {
+       printf("Warning: Trailor tag %s is used by %d boats.\n", locations->trailors.tags[slot],
+              locations->trailors.holders[slot]);
+     }
+   }
+   
+   if (found > MAX_BOOKING_WARNINGS) {
+     printf("Warning: %d more double bookings not listed.\n", found - MAX_BOOKING_WARNINGS);
+   }
+ }
+ 
+ /* Answer a batch location query: "slip|storage [number]", "land <bay>" or "trailor <tag>" */
+ void reportLocation(BoatStore* store, char* argument) {
+   LocationIndex* locations = &store->locations;
+   char* rest;
+   char* kind = strtok_r(argument, " \t", &rest);
+   char* value = strtok_r(NULL, " \t", &rest);
+   
+   if (kind != NULL && (strcasecmp(kind, "slip") == 0 || strcasecmp(kind, "storage") == 0)) {
+     int slip = strcasecmp(kind, "slip") == 0;
+     Occupancy* occupancy = slip ? &locations->slips : &locations->storage;
+     const char* label = slip ? "Slip" : "Storage space";
+     
+     if (value == NULL) {
+       int place = findFreePlace(occupancy, occupancy->places);
+       if (place == 0) {
+         printf("No free %s among %d\n\n", slip ? "slip" : "storage space", occupancy->places);
+       } else {
+         printf("%s %d is free\n\n", label, place);
+       }
+     } 
+     else if (value[0] == '=') {
+       /* The marina's size: later searches for a free place cover places 1 to n */
+       char* end;
+       long places = strtol(value + 1, &end, 10);
+       if (end == value + 1 || *end != '\0' || places < 1 || places > MAX_TRACKED_PLACE) {
+         printf("Error: Invalid number of %s.\n\n", slip ? "slips" : "storage spaces");
+       } else {
+         occupancy->places = (int)places;
+         printf("The marina has %ld %s\n\n", places, slip ? "slips" : "storage spaces");
+       }
+     } else {
+       char* end;
+       long place = strtol(value, &end, 10);
+       if (end == value || *end != '\0' || place < 1 || place > MAX_TRACKED_PLACE) {
+         printf("Error: Invalid %s number.\n\n", slip ? "slip" : "storage space");
+       } else {
+         printf("%s %ld is %s\n\n", label, place, isPlaceFree(occupancy, (int)place) ? "free" : "taken");
+       }
+     }
+   } 
+   else if (kind != NULL && value != NULL && strcasecmp(kind, "land") == 0) {
+     printf("Bay %c holds %d boats\n\n", value[0], locations->bayHolders[(unsigned char)value[0]]);
+   } 
+   else if (kind != NULL && value != NULL && strcasecmp(kind, "trailor") == 0) {
+     int* holders = findTagHolders(&locations->trailors, value, 0);
+     printf("Trailor tag %s is %s\n\n", value, holders != NULL && *holders > 0 ? "taken" : "free");
+   } 
+   else {
+     printf("Error: Invalid location query.\n\n");
+   }
+ }
+ 
+ /* Free the location index */
+ void freeLocationIndex(LocationIndex* locations) {
+   free(locations->slips.taken);
+   free(locations->slips.holders);
+   free(locations->storage.taken);
+   free(locations->storage.holders);
+   free(locations->trailors.tags);
+   free(locations->trailors.holders);
+ }
+ 
+ /* Free all allocated memory */
+ void freeAllBoats(BoatStore* store) {
+   releaseAllBoats(&store->pool);
+   free(store->boats);
+   free(store->index.slots);
+   free(store->index.hashes);
+   free(store->index.sharers);
+   freeLocationIndex(&store->locations);
+   freeNameArena(&store->names);
+   free(store->hot.lengths);
+   free(store->hot.locationTypes);
+   free(store->hot.centsOwed);
+   free(store->hot.dirty);
+   free(store->hot.freeSlots);
+   free(store->rows.text);
+   free(store->rows.offsets);
+   free(store->rows.lengths);
+   free(store->dirtyBoats);
+   initBoatStore(store);
+ }
+ 
+ /* Current time in seconds, for the benchmark */
+ double nowSeconds() {
+   struct timespec now;
+   
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+ }
+ 
+ /* Next value of a xorshift generator, so every benchmark run sees the same data */
+ uint64_t nextRandom(uint64_t* state) {
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return *state;
+ }
+ 
+ /* Format one generated CSV record into line (at least 64 bytes) and return its length */
+ int generateBoatLine(uint64_t* state, char* line) {
+   static const char* const words[] = {"Sea", "Wind", "Moon", "Blue", "Osita", "Run", "Big", "Magic",
+                                        "Star", "Gull", "Tide", "Wave", "Salt", "Reef", "Cove", "Drift"};
+   uint64_t r = nextRandom(state);
+   const char* word = words[r % 16];
+   unsigned int number = (unsigned int)(r >> 8) % 10000000u;
+   int length = 10 + (int)((r >> 32) % 91);
+   unsigned int cents = (unsigned int)(r >> 40) % 500000u;
+   
+   switch ((r >> 4) % 4) {
+     case SLIP:
+       return sprintf(line, "%s %u,%d,slip,%d,%u.%02u\n", word, number, length,
+                      1 + (int)((r >> 24) % MAX_SLIP_NUM), cents / 100, cents % 100);
+     case LAND:
+       return sprintf(line, "%s %u,%d,land,%c,%u.%02u\n", word, number, length,
+                      'A' + (int)((r >> 24) % 26), cents / 100, cents % 100);
+     case TRAILOR:
+       return sprintf(line, "%s %u,%d,trailor,T%05u,%u.%02u\n", word, number, length,
+                      (unsigned int)(r >> 24) % 100000u, cents / 100, cents % 100);
+     default:
+       return sprintf(line, "%s %u,%d,storage,%d,%u.%02u\n", word, number, length,
+                      1 + (int)((r >> 24) % MAX_STORAGE_SPACE), cents / 100, cents % 100);
+   }
+ }
+ 
+ /* Generate CSV text for the given number of boats (returns NULL on failure) */
+ char* generateCsv(int boats, size_t* size) {
+   uint64_t state = 88172645463325252ull;
+   size_t capacity = (size_t)boats * 64 + 1;
+   char* data = (char*)malloc(capacity);
+   
+   *size = 0;
+   if (data == NULL) {
+     return NULL;
+   }
+   for (int i = 0; i < boats; i++) {
+     *size += (size_t)generateBoatLine(&state, data + *size);
+   }
+   return data;
+ }
+ 
+ /* Print one benchmark result line */
+ void reportBenchmark(const char* label, double seconds, double items, const char* unit) {
+   printf("%-40s %10.1f ms  %12.0f %s/s\n", label, seconds * 1000.0, seconds > 0 ? items / seconds : 0.0, unit);
+ }
+ 
+ /* Run the benchmark once for each boat count, so the rates show how each path scales */
+ int runBenchmark(const int* sizes, int sizeCount) {
+   for (int i = 0; i < sizeCount; i++) {
+     if (i > 0) {
+       printf("\n");
+     }
+     if (!benchmarkSize(sizes[i])) {
+       printf("Error: Memory allocation failed.\n");
+       return 1;
+     }
+   }
+   
+   return 0;
+ }
+ 
+ /* Time the hot paths on a store loaded from generated CSV with the given number of boats */
+ int benchmarkSize(int boats) {
+   BoatStore store;
+   size_t size;
+   double start;
+   long long checksum = 0;
+   
+   char* data = generateCsv(boats, &size);
+   if (data == NULL) {
+     return 0;
+   }
+   printf("%d boats, %.1f MB of CSV, %d load threads\n", boats, size / 1e6, countLoadThreads(size));
+   
+   /* Load: parse, store and sort */
+   initBoatStore(&store);
+   initJournal(&store.journal, "");
+   start = nowSeconds();
+   loadCsvData(data, size, &store);
+   reportBenchmark("load CSV (parse, index, sort)", nowSeconds() - start, store.count, "boats");
+   benchmarkNames(&store);
+   
+   benchmarkLookups(&store, &checksum);
+   benchmarkSort(&store);
+   benchmarkStore(&store, boats);
+   benchmarkImport(data, size);
+   benchmarkCharges(&store);
+   benchmarkLoadThreads(data, size);
+   benchmarkFields(data, size, &checksum);
+   benchmarkRecords(data, size, &checksum);
+   benchmarkRecordLayout(&store, &checksum);
+   benchmarkRenderer(&store);
+   benchmarkRowCache(&store);
+   benchmarkSnapshot(&store);
+   printf("Checksum %lld\n", checksum);
+   
+   free(data);
+   free(store.journal.path);
+   freeAllBoats(&store);
+   return 1;
+ }
+ 
+ /* Ordered adds and removes through the (A)dd and (R)emove paths */
+ void benchmarkStore(BoatStore* store, int boats) {
+   int changes = boats < BENCH_CHANGES ? boats : BENCH_CHANGES;
+   char (*added)[64] = (char (*)[64])malloc((size_t)changes * sizeof(*added));
+   uint64_t state = 5489ull;
+   double start;
+   
+   if (added == NULL) {
+     return;
+   }
+   for (int i = 0; i < changes; i++) {
+     generateBoatLine(&state, added[i]);
+     added[i][strcspn(added[i], "\n")] = '\0';
+   }
+   
+   start = nowSeconds();
+   for (int i = 0; i < changes; i++) {
+     addBoat(store, added[i]);
+   }
+   reportBenchmark("addBoat", nowSeconds() - start, changes, "adds");
+   start = nowSeconds();
+   for (int i = 0; i < changes; i++) {
+     added[i][strcspn(added[i], ",")] = '\0';
+     removeBoatByName(store, added[i]);
+   }
+   reportBenchmark("removeBoatByName", nowSeconds() - start, changes, "removes");
+   free(added);
+ }
+ 
+ /* Name lookups: the hash index, binary search and the linear strcasecmp scan they replace */
+ void benchmarkLookups(BoatStore* store, long long* checksum) {
+   int lookups = 1000000;
+   int scans = store->count > 100000 ? 100 : 1000;
+   uint64_t state = 1181783497276652981ull;
+   double start;
+   
+   if (store->count == 0) {
+     return;
+   }
+   
+   start = nowSeconds();
+   for (int i = 0; i < lookups; i++) {
+     *checksum += findBoatByName(store, store->boats[nextRandom(&state) % (uint64_t)store->count]->name) != NULL;
+   }
+   reportBenchmark("findBoatByName (hash index)", nowSeconds() - start, lookups, "lookups");
+   start = nowSeconds();
+   for (int i = 0; i < lookups; i++) {
+     *checksum += findBoatIndex(store, store->boats[nextRandom(&state) % (uint64_t)store->count]->name);
+   }
+   reportBenchmark("findBoatIndex (binary search)", nowSeconds() - start, lookups, "lookups");
+   start = nowSeconds();
+   for (int i = 0; i < scans; i++) {
+     const char* name = store->boats[nextRandom(&state) % (uint64_t)store->count]->name;
+     for (int j = 0; j < store->count; j++) {
+       if (strcasecmp(store->boats[j]->name, name) == 0) {
+         *checksum += j;
+         break;
+       }
+     }
+   }
+   reportBenchmark("linear strcasecmp scan", nowSeconds() - start, scans, "lookups");
+ }
+ 
+ /* Import the first lines of the CSV into an empty store through (A)dd, and through qsort after each append */
+ void benchmarkImport(const char* data, size_t size) {
+   BoatStore store;
+   const char* end = data + size;
+   const char* cursor;
+   char line[64];
+   int lines;
+   double start;
+   
+   initBoatStore(&store);
+   initJournal(&store.journal, "");
+   start = nowSeconds();
+   for (cursor = data, lines = 0; cursor < end && lines < BENCH_IMPORT_LINES; lines++) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     memcpy(line, cursor, (size_t)(lineEnd - cursor));
+     line[lineEnd - cursor] = '\0';
+     addBoat(&store, line);
+     cursor = next;
+   }
+   reportBenchmark("import through addBoat", nowSeconds() - start, lines, "boats");
+   free(store.journal.path);
+   freeAllBoats(&store);
+   
+   initBoatStore(&store);
+   start = nowSeconds();
+   for (cursor = data, lines = 0; cursor < end && lines < BENCH_QSORT_IMPORT_LINES; lines++) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     Boat* boat = allocateBoat(&store.pool);
+     int64_t centsOwed;
+     if (boat == NULL) {
+       break;
+     }
+     if (parseBoatRecord(cursor, lineEnd, boat, &centsOwed, &store.names) != RECORD_OK) {
+       releaseBoat(&store.pool, boat);
+     } 
+     else if (storeLoadedBoat(&store, boat, centsOwed)) {
+       qsort(store.boats, (size_t)store.count, sizeof(Boat*), compareBoats);
+     }
+     cursor = next;
+   }
+   reportBenchmark("import, append and qsort", nowSeconds() - start, lines, "boats");
+   freeAllBoats(&store);
+ }
+ 
+ /* Month-end billing: a per-boat switch over the sorted store, then each kernel the CPU supports */
+ void benchmarkCharges(BoatStore* store) {
+   HotColumns* hot = &store->hot;
+   double start;
+   
+   start = nowSeconds();
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     switch (boatLocationType(boat)) {
+       case SLIP:
+         hot->centsOwed[boat->slot] += (int64_t)boatLength(boat) * SLIP_RATE;
+         break;
+       case LAND:
+         hot->centsOwed[boat->slot] += (int64_t)boatLength(boat) * LAND_RATE;
+         break;
+       case TRAILOR:
+         hot->centsOwed[boat->slot] += (int64_t)boatLength(boat) * TRAILOR_RATE;
+         break;
+       case STORAGE:
+         hot->centsOwed[boat->slot] += (int64_t)boatLength(boat) * STORAGE_RATE;
+         break;
+     }
+   }
+   reportBenchmark("month-end charges, per-boat switch", nowSeconds() - start, store->count, "boats");
+   
+   start = nowSeconds();
+   chargeMonthScalar(hot->lengths, hot->locationTypes, hot->centsOwed, hot->count);
+   reportBenchmark("month-end charges, scalar", nowSeconds() - start, hot->count, "boats");
+ #ifdef HAVE_X86_KERNELS
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("sse2")) {
+     start = nowSeconds();
+     chargeMonthSSE2(hot->lengths, hot->locationTypes, hot->centsOwed, hot->count);
+     reportBenchmark("month-end charges, SSE2", nowSeconds() - start, hot->count, "boats");
+   }
+   if (__builtin_cpu_supports("avx2")) {
+     start = nowSeconds();
+     chargeMonthAVX2(hot->lengths, hot->locationTypes, hot->centsOwed, hot->count);
+     reportBenchmark("month-end charges, AVX2", nowSeconds() - start, hot->count, "boats");
+   }
+   if (__builtin_cpu_supports("avx512f")) {
+     start = nowSeconds();
+     chargeMonthAVX512(hot->lengths, hot->locationTypes, hot->centsOwed, hot->count);
+     reportBenchmark("month-end charges, AVX-512", nowSeconds() - start, hot->count, "boats");
+   }
+ #endif
+ }
+ 
+ /* Parse and sort the whole CSV on 1, 2, 4, ... threads, up to one per core */
+ void benchmarkLoadThreads(const char* data, size_t size) {
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   
+   for (int threads = 1; threads <= cores && threads <= MAX_LOAD_THREADS; threads *= 2) {
+     BoatStore store;
+     char label[64];
+     
+     initBoatStore(&store);
+     double start = nowSeconds();
+     loadCsvDataParallel(data, size, threads, &store);
+     sortBoats(store.boats, store.count);
+     snprintf(label, sizeof(label), "load CSV on %d thread%s", threads, threads == 1 ? "" : "s");
+     reportBenchmark(label, nowSeconds() - start, store.count, "boats");
+     freeAllBoats(&store);
+   }
+ }
+ 
+ /* Sort a shuffled copy of the store with sortBoats and with the qsort it replaced */
+ void benchmarkSort(BoatStore* store) {
+   size_t bytes = (size_t)store->count * sizeof(Boat*) + 1;
+   Boat** shuffled = (Boat**)malloc(bytes);
+   Boat** copy = (Boat**)malloc(bytes);
+   uint64_t state = 2463534242ull;
+   double start;
+   
+   if (shuffled == NULL || copy == NULL) {
+     free(shuffled);
+     free(copy);
+     return;
+   }
+   memcpy(shuffled, store->boats, (size_t)store->count * sizeof(Boat*));
+   for (int i = store->count - 1; i > 0; i--) {
+     int j = (int)(nextRandom(&state) % (uint64_t)(i + 1));
+     Boat* swap = shuffled[i];
+     shuffled[i] = shuffled[j];
+     shuffled[j] = swap;
+   }
+   
+   memcpy(copy, shuffled, (size_t)store->count * sizeof(Boat*));
+   start = nowSeconds();
+   sortBoats(copy, store->count);
+   reportBenchmark("sortBoats (parallel merge sort)", nowSeconds() - start, store->count, "boats");
+   memcpy(copy, shuffled, (size_t)store->count * sizeof(Boat*));
+   start = nowSeconds();
+   qsort(copy, (size_t)store->count, sizeof(Boat*), compareBoats);
+   reportBenchmark("qsort", nowSeconds() - start, store->count, "boats");
+   
+   free(copy);
+   free(shuffled);
+ }
+ 
+ /* Numeric fields: the hand-written parsers against strtok_r and atof/atoi on NUL-terminated copies */
+ void benchmarkFields(const char* data, size_t size, long long* checksum) {
+   const char* end = data + size;
+   double start;
+   
+   start = nowSeconds();
+   for (const char* cursor = data; cursor < end;) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     FieldView fields[5];
+     const char* fieldCursor = cursor;
+     int count = 0;
+     while (count < 5 && nextField(&fieldCursor, lineEnd, &fields[count])) {
+       count++;
+     }
+     if (count == 5) {
+       *checksum += (long long)fieldToDouble(fields[1]) + fieldToInt(fields[3]) + fieldToCents(fields[4]);
+     }
+     cursor = next;
+   }
+   reportBenchmark("numeric fields, hand-written", nowSeconds() - start, size / 1e6, "MB");
+   
+   start = nowSeconds();
+   for (const char* cursor = data; cursor < end;) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     char line[64];
+     char* rest;
+     memcpy(line, cursor, (size_t)(lineEnd - cursor));
+     line[lineEnd - cursor] = '\0';
+     strtok_r(line, ",", &rest);
+     *checksum += (long long)atof(strtok_r(NULL, ",", &rest));
+     strtok_r(NULL, ",", &rest);
+     *checksum += atoi(strtok_r(NULL, ",", &rest));
+     *checksum += (long long)(atof(strtok_r(NULL, ",", &rest)) * 100.0);
+     cursor = next;
+   }
+   reportBenchmark("numeric fields, strtok_r + atof/atoi", nowSeconds() - start, size / 1e6, "MB");
+ }
+ 
+ /* Whole records through parseBoatRecord, the parser shared by file loads and (A)dd */
+ void benchmarkRecords(const char* data, size_t size, long long* checksum) {
+   const char* end = data + size;
+   NameArena names = {NULL};
+   double start = nowSeconds();
+   
+   for (const char* cursor = data; cursor < end;) {
+     const char* lineEnd;
+     const char* next = nextCsvLine(cursor, end, &lineEnd);
+     Boat boat;
+     int64_t centsOwed;
+     if (parseBoatRecord(cursor, lineEnd, &boat, &centsOwed, &names) == RECORD_OK) {
+       *checksum += centsOwed;
+     }
+     cursor = next;
+   }
+   reportBenchmark("parseBoatRecord", nowSeconds() - start, size / 1e6, "MB");
+   freeNameArena(&names);
+ }
+ 
+ /* Name memory per boat in the arena (sort key, name and tag), against the old inline name buffer */
+ void benchmarkNames(BoatStore* store) {
+   size_t nameBytes = 0;
+   
+   for (NameBlock* block = store->names.blocks; block != NULL; block = block->next) {
+     nameBytes += block->used;
+   }
+   printf("Name arena %.1f bytes per boat (inline name buffer %d)\n",
+          store->count > 0 ? (double)nameBytes / store->count : 0.0, MAX_NAME_LENGTH);
+ }
+ 
+ /* Boat record size, and a scan over every boat's length and place, against the unpacked layout it replaced */
+ void benchmarkRecordLayout(BoatStore* store, long long* checksum) {
+   typedef struct {
+     char name[MAX_NAME_LENGTH];
+     float length;
+     LocationType locationType;
+     union {
+       int number;
+       char trailorTag[10];
+     } locationInfo;
+     float amountOwed;
+   } UnpackedBoat;
+   UnpackedBoat* unpacked = (UnpackedBoat*)malloc((size_t)store->hot.count * sizeof(UnpackedBoat) + 1);
+   UnpackedBoat** sorted = (UnpackedBoat**)malloc((size_t)store->count * sizeof(UnpackedBoat*) + 1);
+   double start;
+   
+   printf("Boat record %zu bytes (unpacked layout %zu)\n", sizeof(Boat), sizeof(UnpackedBoat));
+   if (unpacked == NULL || sorted == NULL) {
+     free(unpacked);
+     free(sorted);
+     return;
+   }
+   
+   /* Unpacked records sit in load order and are reached in name order, like the boats */
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     sorted[i] = &unpacked[boat->slot];
+     snprintf(sorted[i]->name, sizeof(sorted[i]->name), "%s", boat->name);
+     sorted[i]->length = (float)boatLength(boat);
+     sorted[i]->locationType = boatLocationType(boat);
+     sorted[i]->locationInfo.number = boat->location;
+     sorted[i]->amountOwed = 0.0f;
+   }
+   
+   start = nowSeconds();
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     *checksum += boatLength(boat) + (boatLocationType(boat) == SLIP ? boatSlipNumber(boat) : 0);
+   }
+   reportBenchmark("scan records, packed", nowSeconds() - start, store->count, "boats");
+   start = nowSeconds();
+   for (int i = 0; i < store->count; i++) {
+     *checksum += (long long)sorted[i]->length + (sorted[i]->locationType == SLIP ? sorted[i]->locationInfo.number : 0);
+   }
+   reportBenchmark("scan records, unpacked", nowSeconds() - start, store->count, "boats");
+   free(sorted);
+   free(unpacked);
+ }
+ 
+ /* Render the whole inventory to /dev/null with printf and with the buffered renderer */
+ void benchmarkRenderer(BoatStore* store) {
+   FILE* null = fopen("/dev/null", "w");
+   RenderBuffer* buffer = (RenderBuffer*)malloc(sizeof(RenderBuffer));
+   double start;
+   
+   if (null == NULL || buffer == NULL) {
+     free(buffer);
+     if (null != NULL) {
+       fclose(null);
+     }
+     return;
+   }
+   
+   start = nowSeconds();
+   for (int i = 0; i < store->count; i++) {
+     Boat* boat = store->boats[i];
+     fprintf(null, "%-20s %3d' ", boat->name, boatLength(boat));
+     switch (boatLocationType(boat)) {
+       case SLIP:
+         fprintf(null, "%8s   # %2d", "slip", boatSlipNumber(boat));
+         break;
+       case LAND:
+         fprintf(null, "%8s      %c", "land", boatBayLetter(boat));
+         break;
+       case TRAILOR:
+         fprintf(null, "%8s %6s", "trailor", boatTrailorTag(boat));
+         break;
+       case STORAGE:
+         fprintf(null, "%8s   # %2d", "storage", boatStorageSpace(boat));
+         break;
+     }
+     fprintf(null, "   Owes $%7.2f\n", store->hot.centsOwed[boat->slot] / 100.0);
+   }
+   fflush(null);
+   reportBenchmark("inventory, printf", nowSeconds() - start, store->count, "rows");
+   
+   buffer->used = 0;
+   buffer->fd = fileno(null);
+   start = nowSeconds();
+   for (int i = 0; i < store->count; i++) {
+     if (RENDER_BUFFER_BYTES - buffer->used < MAX_ROW_LENGTH) {
+       flushRenderBuffer(buffer);
+     }
+     buffer->used += renderBoatRow(store, store->boats[i], buffer->data + buffer->used);
+   }
+   flushRenderBuffer(buffer);
+   reportBenchmark("inventory, renderer", nowSeconds() - start, store->count, "rows");
+   
+   free(buffer);
+   fclose(null);
+ }
+ 
+ /* Show the inventory twice through the row cache, filling it and then reading from it */
+ void benchmarkRowCache(BoatStore* store) {
+   int fd = open("/dev/null", O_WRONLY);
+   RenderBuffer* buffer = (RenderBuffer*)malloc(sizeof(RenderBuffer));
+   double start;
+   
+   if (fd != -1 && buffer != NULL) {
+     buffer->used = 0;
+     buffer->fd = fd;
+     invalidateAllRows(&store->rows);
+     start = nowSeconds();
+     writeBoats(store, 0, store->count, buffer);
+     reportBenchmark("inventory, filling row cache", nowSeconds() - start, store->count, "rows");
+     start = nowSeconds();
+     writeBoats(store, 0, store->count, buffer);
+     reportBenchmark("inventory, from row cache", nowSeconds() - start, store->count, "rows");
+   }
+   
+   free(buffer);
+   if (fd != -1) {
+     close(fd);
+   }
+ }
+ 
+ /* Save the store as CSV and as a snapshot, then time loading each file back (from the page cache) */
+ void benchmarkSnapshot(BoatStore* store) {
+   const char* directory = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+   char csvPath[PATH_MAX];
+   char snapshotPath[PATH_MAX];
+   struct stat csvStat;
+   struct stat snapshotStat;
+   double start;
+   
+   snprintf(csvPath, sizeof(csvPath), "%s/boatbench-%d.csv", directory, (int)getpid());
+   snprintf(snapshotPath, sizeof(snapshotPath), "%s/boatbench-%d%s", directory, (int)getpid(), SNAPSHOT_EXTENSION);
+   
+   start = nowSeconds();
+   if (!saveCsvData(csvPath, store)) {
+     return;
+   }
+   reportBenchmark("save CSV (with fsync)", nowSeconds() - start, store->count, "boats");
+   start = nowSeconds();
+   if (!saveSnapshot(snapshotPath, store)) {
+     unlink(csvPath);
+     return;
+   }
+   reportBenchmark("save snapshot (with fsync)", nowSeconds() - start, store->count, "boats");
+   
+   if (stat(csvPath, &csvStat) == 0 && stat(snapshotPath, &snapshotStat) == 0) {
+     printf("%-40s %10.1f MB  %12.1f MB snapshot\n", "file size, CSV and snapshot",
+            csvStat.st_size / 1e6, snapshotStat.st_size / 1e6);
+   }
+   reportBenchmark("load CSV file (saved sorted)", benchmarkLoadFile(csvPath, 0), store->count, "boats");
+   reportBenchmark("load snapshot file", benchmarkLoadFile(snapshotPath, 1), store->count, "boats");
+   
+   unlink(csvPath);
+   unlink(snapshotPath);
+ }
+ 
+ /* Seconds to map and load a saved CSV file or snapshot into an empty store, as a restart does */
+ double benchmarkLoadFile(const char* path, int snapshot) {
+   BoatStore store;
+   size_t size;
+   int mapped;
+   double start = nowSeconds();
+   
+   initBoatStore(&store);
+   int fd = open(path, O_RDONLY);
+   if (fd != -1) {
+     const char* data = mapFile(fd, &size, &mapped);
+     close(fd);
+     if (data != NULL) {
+       if (snapshot) {
+         loadSnapshot(data, size, &store);
+       } else {
+         loadCsvData(data, size, &store);
+       }
+       unmapFile(data, size, mapped);
+     }
+   }
+   double seconds = nowSeconds() - start;
+   
+   freeAllBoats(&store);
+   return seconds;
+ }